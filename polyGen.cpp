@@ -1,16 +1,9 @@
 
 #include <math.h>
+#include <string.h>
 #include <new>
 #include <distingnt/api.h>
-
-#ifndef PI
-    #define PI             3.14159265
-#endif // ! PI
-#ifndef PI_HALF
-    #define PI_HALF     (PI/2.0)
-#endif // ! PI_HALF
-
-#define BASE_FREQ_HZ       261.6256f // f0 (base frequency) in Hz
+#include "polyGenEngine.h"
 
 #define VOLTAGE_PARAM_SCALING     1 // scaling (n) in parameter definition
 #define VOLTAGE_SCALING          10 // scaling (10^n)
@@ -19,16 +12,6 @@
 #define    MAX_PARAMETER_VAL     ((int16_t)(0x7FFF))   // Parameters are int16?
 #define    DEF_PARAMETER_VAL     ((int16_t)0)
 
-
-#define TS_POLYGEN_VERTICES_MIN        3    // Min # vertices/sides in polygon
-#define TS_POLYGEN_VERTICES_MAX        36     // Max #vertices/sides in polygon. Wanted 32 but for a nice 3 sides/Volt, we can do 33 I guess
-#define TS_POLYGEN_VERTICES_DEF        3     // Default # vertices/sides in polygon
-#define TS_POLYGEN_ANGLE_OFFSET_DEG_MIN        -180    // Initial rotation/angle offset min
-#define TS_POLYGEN_ANGLE_OFFSET_DEG_MAX         180    // Initial rotation/angle offset max
-#define TS_POLYGEN_ANGLE_OFFSET_DEG_DEF           0    // Initial rotation/angle offset default
-
-#define BUFF_SIZE   ((TS_POLYGEN_VERTICES_MAX*2))
-
 #define TS_CV_INPUT_RANGE_MIN            -12.0f    // Min Rack states should be 'allowed'
 #define TS_CV_INPUT_RANGE_MAX             12.0f    // Max Rack states should be 'allowed'
 #define TS_CV_INPUT_MIN_DEF                  0.0f    // Our CV Input min value (was -5V), now 0 so it will match MIDI controllers.
@@ -36,58 +19,24 @@
 #define TS_CV_OUTPUT_MIN_DEF            -10.0f    // Our CV OUTPUT minimum
 #define TS_CV_OUTPUT_MAX_DEF             10.0f    // Our CV OUTPUT maximum
 
-#define TS_POLYGEN_AMPL_MIN            -10.0f
-#define TS_POLYGEN_AMPL_MAX            10.0f
-#define TS_POLYGEN_AMPL_DEF            5.0f
-
-#define TS_POLGEN_ROT_DEG_MIN        -720.0f  // Rotation min (degrees). Why did we make 2 rotations? Don't remember now...
-#define TS_POLGEN_ROT_DEG_MAX         720.0f     // Rotation max (degrees)
-#define TS_POLGEN_ROT_DEG_DEF           0.0f  // Rotation def (degrees)
-
-// Inner Radius ======================
-#define TS_POLYGEN_INNER_RADIUS_MULT_MIN    -5.0f // -500%
-#define TS_POLYGEN_INNER_RADIUS_MULT_MAX     5.0f // +500%
-#define TS_POLYGEN_INNER_RADIUS_MULT_DEF     1.0f //  100%
-
-#define TS_POLYGEN_INNER_OFFSET_DEG_MIN     -5.0f
-#define TS_POLYGEN_INNER_OFFSET_DEG_MAX     5.0f
-#define TS_POLYGEN_INNER_OFFSET_DEG_DEF     0.0f
-
-#define TS_POLYGEN_BUFF_SIZE            1024
-
-#define SINFUNC(x)                    sinf(x)
-#define COSFUNC(x)                    cosf(x)
-
-#define SQRTFUNC(x)                   sqrtf(x)
-
-#define SGN(x)      ( (x < 0.0f) ? -1.0f : 1.0f )
-
-#define DEBUG_POLY        0
-
-#define TS_POLYGEN_IRADIUS_REL_2_MID_POINT        1 // Inner radius multiplier is multiplied by 0:Outer Amplitude, 1:Mid Point of line between corners
-#define TS_POLYGEN_MOD_ENABLED                    0 // Add modulation items. Currently we don't add these, we ran out of panel space and decided not needed since users can technically do this with the outputs in another module.
-                                                  // If turned back on, we have to add controls and such for these inputs/parameters.
-#define TS_POLYGEN_TRIGGER_SYNC_EARLY            0 // (1) Trigger sync 1 dt before next cycle or (0) wait until we are actually starting the next cycle.
-
-
-struct Vec {
-    float x;
-    float y;
-    Vec(){return;}
-    Vec(float _x, float _y){
-        this->x = _x;
-        this->y = _y;
-    }
-};
-
-float clamp(float val, float min, float max){
-    if (val < min)
-        return min;
-    else if (val > max)
-        return max;
-    else
-        return val;
-}
+// Debug Trace (record/replay) =======
+#define TS_POLYGEN_TRACE_KB_MAX          4096    // Max trace buffer size (KB, in DRAM). 0 (default) for no trace.
+#define TS_POLYGEN_TRACE_MAGIC      NT_MULTICHAR( 'p', 'G', 't', 'r' )
+#define TS_POLYGEN_TRACE_VERSION            3
+#define TS_POLYGEN_TRACE_FLAG_FULL       0x01    // Trace stopped because the buffer filled up
+#define TS_POLYGEN_TRACE_FLAG_CUT        0x02    // Saved trace is only the start of the buffer (TS_POLYGEN_TRACE_EXPORT_KB)
+#define TS_POLYGEN_TRACE_EXPORT_KB         64    // Most of the trace Trace Export saves with the preset (KB)
+
+// Preview Rasterizer ================
+#define TS_POLYGEN_SCREEN_WIDTH           256    // Pixels
+#define TS_POLYGEN_SCREEN_HEIGHT           64    // Pixels
+#define TS_POLYGEN_SCREEN_BYTES         (TS_POLYGEN_SCREEN_WIDTH * TS_POLYGEN_SCREEN_HEIGHT / 2)  // 2 pixels (4-bit) per byte
+#define TS_POLYGEN_DECAY_MIN                1    // Persistence: brightness levels lost per frame
+#define TS_POLYGEN_DECAY_MAX               15
+#define TS_POLYGEN_DECAY_DEF                2
+#define TS_POLYGEN_CURVE_DRAW_STEPS         4    // # lines per curved edge in the preview (fewer with lots of edges)
+#define TS_POLYGEN_DRAW_MAX_LINES         256    // Preview: curved edges aren't split more than this in total
+#define TS_POLYGEN_DRAW_MIN_SEGMENT_PX   1.0f    // Preview: skip points closer than this (pixels) to the last one drawn
 
 // Given the int16 value that a parameter gives us, rescale it into the float min,max we actually want.
 float scale(int16_t paramVal, int16_t inMin, int16_t inMax, float outMin, float outMax) {
@@ -109,51 +58,75 @@ int16_t scale_i(float paramVal, float inMin, float inMax){
 
 
 
+// Header at the start of the trace buffer. Followed by the records, length is the total # bytes used (including this).
+// Records (packed, little-endian):
+//   'P' uint8 parameter, int16 value                    - parameterChanged()
+//   'B' uint8 # channels, uint16 # frames,               - step()
+//       uint32 cycles, uint32 output hash, uint8 auto tier, 3 pad,
+//       float[# channels][# frames] input bus(es)
+//   'S' uint8 snapshot, uint8 flags, 1 pad,             - morph snapshot A/B (at the start, and on preset load)
+//       uint16 # points, 2 pad,
+//       float[# points][2] points, lin, quad
+struct _polyGenTraceHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t numParameters;
+    uint32_t sampleRate;
+    uint32_t length;
+    uint32_t flags;
+};
+
+// Trace record types
+enum TraceRecordType : uint8_t
+{
+    TRACE_PARAMETER = 'P',
+    TRACE_BLOCK = 'B',
+    TRACE_SNAPSHOT = 'S'
+};
+
+// Trace snapshot record flags
+enum TraceSnapshotFlags : uint8_t
+{
+    TRACE_SNAPSHOT_STORED = 0x01,
+    TRACE_SNAPSHOT_CURVES = 0x02,
+    TRACE_SNAPSHOT_PENDING = 0x04   // Store Snapshot requested, not done yet
+};
+
+// Part of a raster image that may have lit pixels: rows, and 32-bit words (8 pixels) along a row. Empty when top > bottom.
+struct _polyGenRasterBox
+{
+    int top = TS_POLYGEN_SCREEN_HEIGHT;
+    int bottom = -1;
+    int left = TS_POLYGEN_SCREEN_WIDTH / 8;
+    int right = -1;
+};
+
 struct _polyGenAlgorithm : public _NT_algorithm
 {
     //_polyGenAlgorithm( _polyGenAlgorithm_DTC* dtc_ ) : dtc( dtc_ ) {}
     _polyGenAlgorithm() {}
 	~_polyGenAlgorithm() {}
 	
-	//float gain;
-    
-    //_polyGenAlgorithm_DTC* dtc;
-    //_polyGenInputs* dtc;
-    // Phase
-    float phase = 0.0f;
-    // Current Vertex
-    int currVertexIx = 0;
-    // Next Vertex
-    int nextVertexIx = 1;
-    // Main shape, number of sides/vertices
-    uint8_t numVertices = TS_POLYGEN_VERTICES_DEF;
-    float angleOffset_rad = 0.0f;
-    float xAmpl = TS_POLYGEN_AMPL_DEF;
-    float yAmpl = TS_POLYGEN_AMPL_DEF;
-    float xOffset = 0.0f;
-    float yOffset = 0.0f;
-    // Pre offset (center of rotation) X
-    float xCRot = 0.0f;
-    // Pre offset (center of rotation) Y
-    float yCRot = 0.0f;
-    // Rotation
-    bool rotationIsAbs = true;
-    float rotation_rad = 0.0f;
-    float rotation_deg = 0.0f;
-    int lastRotationAbs = -1;
-
-    // Frequency 
-    float frequencyParam_V = 0.0f;
-    
-    //=== * Inner Vertices * ===
-    float innerRadiusMult = TS_POLYGEN_INNER_RADIUS_MULT_DEF;     // Multiplier for radius (relative to main shape)
-    float innerAngleMult = TS_POLYGEN_INNER_OFFSET_DEG_DEF;     // Multiplier for angle (relative to the mid-angle of main shape)
-    float innerPhase = 0.0f;         // Inner/2ndary phase.
-    int innerSideIx = 0;            // Which side we are on (from inner/2ndary point). Either 0 (before inner vertex) or 1 (after inner vertex).
-    bool useInnerVerts = false;
+    // Everything step() renders (polyGenEngine.h)
+    _polyGenEngine engine;
+
+    //=== * Debug Trace * ===
+    uint8_t* traceBuffer = NULL;     // In DRAM (NULL if no trace buffer)
+    uint32_t traceSize = 0;          // Bytes
+    bool traceCapture = false;       // Currently recording
+    bool traceStartPending = false;  // Trace Capture turned on, start at the next step() (not in the middle of one)
+    bool traceExport = false;        // Trace Export turned on: the next serialise() saves the stopped trace (once)
+
+    //=== * Morph * ===
+    int16_t morphStoreLast = 0;      // Store Snapshot value at the last parameterChanged() (a store is the change into A/B)
 
     // UI
     bool topBarOn = true;
+    uint8_t previewMode = 0;         // PreviewMode
+    uint8_t decay = TS_POLYGEN_DECAY_DEF;  // Persistence decay (levels per frame)
+    uint8_t* persistScreen = NULL;   // Persistence image (same layout as NT_screen, in DRAM)
+    _polyGenRasterBox persistBox;    // Where the persistence image has lit pixels (the only part decayed & blended)
 };
 
 // Parameter ids/indices
@@ -187,39 +160,162 @@ enum ParamIds : uint8_t
     // Apply ABSOLUTE rotation or RELATIVE rotation (true/false)
     ROTATION_ABS_PARAM,
     // In the other screen, if the top bar shows or not
-    TOP_BAR_UI_PARAM
+    TOP_BAR_UI_PARAM,
+    // Number of shapes to draw (time-multiplexed on the same X/Y outputs)
+    NUM_SHAPES_PARAM,
+    // Share of samples each shape gets per frame: Equal or By # Sides
+    SHAPE_SHARE_PARAM,
+    // Shapes 2 to 4: # sides, scale, X offset, Y offset and rotation for each
+    SHAPE2_NUM_VERTICES_PARAM,
+    SHAPE2_SCALE_PARAM,
+    SHAPE2_X_OFFSET_PARAM,
+    SHAPE2_Y_OFFSET_PARAM,
+    SHAPE2_ROTATION_PARAM,
+    SHAPE3_NUM_VERTICES_PARAM,
+    SHAPE3_SCALE_PARAM,
+    SHAPE3_X_OFFSET_PARAM,
+    SHAPE3_Y_OFFSET_PARAM,
+    SHAPE3_ROTATION_PARAM,
+    SHAPE4_NUM_VERTICES_PARAM,
+    SHAPE4_SCALE_PARAM,
+    SHAPE4_X_OFFSET_PARAM,
+    SHAPE4_Y_OFFSET_PARAM,
+    SHAPE4_ROTATION_PARAM,
+    // Curvature of the edges (quadratic Bezier). 0 is straight edges.
+    CURVATURE_PARAM,
+    // Band-limited corners for audio use (Off/On)
+    ANTI_ALIAS_PARAM,
+    // Corner trigger output (optional)
+    kParamTriggerOutput,
+    // Blanking gate output (optional)
+    kParamBlankOutput,
+    // Corner trigger pulse width (ms)
+    TRIGGER_WIDTH_PARAM,
+    // What blanks the beam: Corners, Corners + Retrace, Retrace
+    BLANK_MODE_PARAM,
+    // Blanking pulse width (ms)
+    BLANK_WIDTH_PARAM,
+    // Blanking gate level (V)
+    BLANK_LEVEL_PARAM,
+    // Debug: record parameter changes & input blocks to the trace buffer (Off/On)
+    TRACE_CAPTURE_PARAM,
+    // Quality: Auto, Full, Control Rate, Cached
+    QUALITY_PARAM,
+    // CPU budget for Auto quality (% of the block time)
+    CPU_BUDGET_PARAM,
+    // Preview drawing: Smooth (NT lines), Fast (our rasterizer), Persistence (rasterizer, fading trails)
+    PREVIEW_PARAM,
+    // Persistence decay (brightness levels per frame)
+    DECAY_PARAM,
+    // How the frequency input is used: Exponential (V/Oct), Linear (Hz/V), Through-Zero (Hz/V, negative runs backwards)
+    FM_MODE_PARAM,
+    // Linear/Through-Zero FM depth (Hz/V)
+    FM_DEPTH_PARAM,
+    // Morph between the stored snapshots A & B (Off/On)
+    MORPH_PARAM,
+    // Morph amount (0% is A, 100% is B)
+    MORPH_AMOUNT_PARAM,
+    // Morph CV input (optional, added to the amount)
+    kParamMorphInput,
+    // Store the main shape as it is now: -, Store A, Store B
+    MORPH_STORE_PARAM,
+    // LFO mode: frequency range 10 octaves lower, shape worked out per block and ramped in between (Off/On)
+    LFO_MODE_PARAM,
+    // Debug: save the stopped trace with the next preset save (Off/On, saves once each time it's turned on)
+    TRACE_EXPORT_PARAM
 };
 
-#define FREQ_PARAM_SCALING  2
-#define FREQ_SCALING        100
+// Preview parameter values
+enum PreviewMode : uint8_t
+{
+    // Antialiased float lines (NT_drawShapeF)
+    PREVIEW_SMOOTH,
+    // Integer lines straight into NT_screen
+    PREVIEW_FAST,
+    // Integer lines into our own image, which fades instead of being cleared
+    PREVIEW_PERSISTENCE
+};
 
-// #define TROWA_FREQ_KNOB_MIN     0
-// #define TROWA_FREQ_KNOB_MAX     32000
-// #define TROWA_FREQ_KNOB_DEF     261
+// Input busses recorded with each trace block (every bus step() reads)
+static const uint8_t traceInputParams[] = { kParamInput, kParamMorphInput };
 
-#define TROWA_FREQ_KNOB_MIN     -5
-#define TROWA_FREQ_KNOB_MAX      5
-#define TROWA_FREQ_KNOB_DEF      0
+// # parameters for each extra shape (the shape parameter ids are in the same order for each shape)
+#define SHAPE_NUM_PARAMS    (SHAPE3_NUM_VERTICES_PARAM - SHAPE2_NUM_VERTICES_PARAM)
 
-#define TROWA_FREQ_VOLTAGE_MIN     -5
-#define TROWA_FREQ_VOLTAGE_MAX      5
-#define TROWA_FREQ_VOLTAGE_DEF      0
+#define FREQ_PARAM_SCALING  2
+#define FREQ_SCALING        100
 
 static char const * const enumStringsOnOff[] = {
 	"Off",
 	"On",
 };
 
+static char const * const enumStringsShapeShare[] = {
+	"Equal",
+	"By Sides",
+};
+
+// Parameters for one of the extra shapes (n is the shape number, 2 to TS_POLYGEN_SHAPES_MAX)
+#define TS_POLYGEN_SHAPE_PARAMETERS(n, defSides) \
+    { .name = "Shape " #n " # Sides", \
+        .min = TS_POLYGEN_VERTICES_MIN, .max = TS_POLYGEN_VERTICES_MAX, .def = defSides, \
+        .unit = kNT_unitNone, .scaling = 0, .enumStrings = NULL }, \
+    { .name = "Shape " #n " Scale", \
+        .min = static_cast<int16_t>(TS_POLYGEN_SHAPE_SCALE_MIN * 100), \
+        .max = static_cast<int16_t>(TS_POLYGEN_SHAPE_SCALE_MAX * 100), \
+        .def = static_cast<int16_t>(TS_POLYGEN_SHAPE_SCALE_DEF * 100), \
+        .unit = kNT_unitPercent, .scaling = 0, .enumStrings = NULL }, \
+    { .name = "Shape " #n " X Offset", \
+        .min = static_cast<int16_t>(TS_POLYGEN_AMPL_MIN * VOLTAGE_SCALING), \
+        .max = static_cast<int16_t>(TS_POLYGEN_AMPL_MAX * VOLTAGE_SCALING), \
+        .def = 0, \
+        .unit = kNT_unitVolts, .scaling = VOLTAGE_PARAM_SCALING, .enumStrings = NULL }, \
+    { .name = "Shape " #n " Y Offset", \
+        .min = static_cast<int16_t>(TS_POLYGEN_AMPL_MIN * VOLTAGE_SCALING), \
+        .max = static_cast<int16_t>(TS_POLYGEN_AMPL_MAX * VOLTAGE_SCALING), \
+        .def = 0, \
+        .unit = kNT_unitVolts, .scaling = VOLTAGE_PARAM_SCALING, .enumStrings = NULL }, \
+    { .name = "Shape " #n " Rotation", \
+        .min = TS_POLYGEN_ANGLE_OFFSET_DEG_MIN, .max = TS_POLYGEN_ANGLE_OFFSET_DEG_MAX, .def = TS_POLYGEN_ANGLE_OFFSET_DEG_DEF, \
+        .unit = kNT_unitNone, .scaling = 0, .enumStrings = NULL },
+
+static char const * const enumStringsQuality[] = {
+	"Auto",
+	"Full",
+	"Control Rate",
+	"Cached"
+};
+static char const * const enumStringsFMMode[] = {
+	"Exponential",
+	"Linear",
+	"Through-Zero"
+};
+static char const * const enumStringsPreview[] = {
+	"Smooth",
+	"Fast",
+	"Persistence"
+};
+static char const * const enumStringsMorphStore[] = {
+	"-",
+	"Store A",
+	"Store B"
+};
+static char const * const enumStringsBlankMode[] = {
+	"Corners",
+	"Corners+Retrace",
+	"Retrace",
+};
+
 static const _NT_parameter	parameters[] = {
     //{ .name = "name", .min = MIN, .max = MAX, .def = DEF, .unit = UNIT, .scaling = 0, .enumStrings = NULL },
     NT_PARAMETER_AUDIO_INPUT( "Frequency Input", 1, 1 )
     NT_PARAMETER_AUDIO_OUTPUT_WITH_MODE( "Output X", 1, 13 )	
 	NT_PARAMETER_AUDIO_OUTPUT_WITH_MODE( "Output Y", 1, 14 )
     { .name = "Frequency", 
-        .min = TROWA_FREQ_KNOB_MIN * FREQ_SCALING, .max = TROWA_FREQ_KNOB_MAX * FREQ_SCALING, .def = TROWA_FREQ_KNOB_DEF * FREQ_SCALING, 
+        .min = TS_POLYGEN_FREQ_KNOB_MIN * FREQ_SCALING, .max = TS_POLYGEN_FREQ_KNOB_MAX * FREQ_SCALING, .def = TS_POLYGEN_FREQ_KNOB_DEF * FREQ_SCALING, 
         .unit = kNT_unitVolts, .scaling = FREQ_PARAM_SCALING, .enumStrings = NULL },
     // { .name = "Frequency", 
-    //     .min = TROWA_FREQ_KNOB_MIN, .max = TROWA_FREQ_KNOB_MAX, .def = TROWA_FREQ_KNOB_DEF, 
+    //     .min = TS_POLYGEN_FREQ_KNOB_MIN, .max = TS_POLYGEN_FREQ_KNOB_MAX, .def = TS_POLYGEN_FREQ_KNOB_DEF, 
     //     .unit = kNT_unitHz, .scaling = 0, .enumStrings = NULL },
     { .name = "# Sides", 
         .min = TS_POLYGEN_VERTICES_MIN, .max = TS_POLYGEN_VERTICES_MAX, .def = TS_POLYGEN_VERTICES_DEF, 
@@ -283,12 +379,65 @@ static const _NT_parameter	parameters[] = {
         .def = static_cast<int16_t>( TS_POLGEN_ROT_DEG_DEF ), 
         .unit = kNT_unitNone, .scaling = 0, .enumStrings = NULL },
     { .name = "Spin", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
-    { .name = "Top Bar", .min = 0, .max = 1, .def = 1, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff }
+    { .name = "Top Bar", .min = 0, .max = 1, .def = 1, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
+    { .name = "# Shapes", 
+        .min = TS_POLYGEN_SHAPES_MIN, .max = TS_POLYGEN_SHAPES_MAX, .def = TS_POLYGEN_SHAPES_DEF, 
+        .unit = kNT_unitNone, .scaling = 0, .enumStrings = NULL },
+    { .name = "Shape Share", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsShapeShare },
+    TS_POLYGEN_SHAPE_PARAMETERS(2, 4)
+    TS_POLYGEN_SHAPE_PARAMETERS(3, 5)
+    TS_POLYGEN_SHAPE_PARAMETERS(4, 6)
+    { .name = "Curvature", 
+        .min = static_cast<int16_t>(TS_POLYGEN_CURVATURE_MIN * 100), 
+        .max = static_cast<int16_t>(TS_POLYGEN_CURVATURE_MAX * 100), 
+        .def = static_cast<int16_t>(TS_POLYGEN_CURVATURE_DEF * 100), 
+        .unit = kNT_unitPercent, .scaling = 0, .enumStrings = NULL },
+    { .name = "Anti-Alias", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
+    NT_PARAMETER_AUDIO_OUTPUT( "Trigger Output", 0, 0 )
+    NT_PARAMETER_AUDIO_OUTPUT( "Blank Output", 0, 0 )
+    { .name = "Trigger Width", 
+        .min = static_cast<int16_t>(TS_POLYGEN_GATE_WIDTH_MS_MIN * 10), 
+        .max = static_cast<int16_t>(TS_POLYGEN_GATE_WIDTH_MS_MAX * 10), 
+        .def = static_cast<int16_t>(TS_POLYGEN_TRIGGER_WIDTH_MS_DEF * 10), 
+        .unit = kNT_unitMs, .scaling = 1, .enumStrings = NULL },
+    { .name = "Blank Mode", .min = 0, .max = 2, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsBlankMode },
+    { .name = "Blank Width", 
+        .min = static_cast<int16_t>(TS_POLYGEN_GATE_WIDTH_MS_MIN * 10), 
+        .max = static_cast<int16_t>(TS_POLYGEN_GATE_WIDTH_MS_MAX * 10), 
+        .def = static_cast<int16_t>(TS_POLYGEN_BLANK_WIDTH_MS_DEF * 10), 
+        .unit = kNT_unitMs, .scaling = 1, .enumStrings = NULL },
+    { .name = "Blank Level", 
+        .min = static_cast<int16_t>(TS_POLYGEN_AMPL_MIN * VOLTAGE_SCALING), 
+        .max = static_cast<int16_t>(TS_POLYGEN_AMPL_MAX * VOLTAGE_SCALING), 
+        .def = static_cast<int16_t>(TS_POLYGEN_BLANK_V_DEF * VOLTAGE_SCALING), 
+        .unit = kNT_unitVolts, .scaling = VOLTAGE_PARAM_SCALING, .enumStrings = NULL },
+    { .name = "Trace Capture", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
+    { .name = "Quality", .min = QUALITY_AUTO, .max = QUALITY_CACHED, .def = QUALITY_FULL, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsQuality },
+    { .name = "CPU Budget", 
+        .min = static_cast<int16_t>(TS_POLYGEN_CPU_BUDGET_MIN), 
+        .max = static_cast<int16_t>(TS_POLYGEN_CPU_BUDGET_MAX), 
+        .def = static_cast<int16_t>(TS_POLYGEN_CPU_BUDGET_DEF), 
+        .unit = kNT_unitPercent, .scaling = 0, .enumStrings = NULL },
+    { .name = "Preview", .min = PREVIEW_SMOOTH, .max = PREVIEW_PERSISTENCE, .def = PREVIEW_SMOOTH, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsPreview },
+    { .name = "Decay", .min = TS_POLYGEN_DECAY_MIN, .max = TS_POLYGEN_DECAY_MAX, .def = TS_POLYGEN_DECAY_DEF, .unit = kNT_unitNone, .scaling = 0, .enumStrings = NULL },
+    { .name = "FM Mode", .min = FM_EXPONENTIAL, .max = FM_THROUGH_ZERO, .def = FM_EXPONENTIAL, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsFMMode },
+    { .name = "FM Depth", .min = TS_POLYGEN_FM_DEPTH_MIN, .max = TS_POLYGEN_FM_DEPTH_MAX, .def = TS_POLYGEN_FM_DEPTH_DEF, .unit = kNT_unitHz, .scaling = 0, .enumStrings = NULL },
+    { .name = "Morph", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
+    { .name = "Morph Amount", .min = 0, .max = 1000, .def = 0, .unit = kNT_unitPercent, .scaling = 1, .enumStrings = NULL },
+    NT_PARAMETER_AUDIO_INPUT( "Morph Input", 0, 0 )
+    { .name = "Store Snapshot", .min = 0, .max = TS_POLYGEN_SNAPSHOTS, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsMorphStore },
+    { .name = "LFO Mode", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
+    { .name = "Trace Export", .min = 0, .max = 1, .def = 0, .unit = kNT_unitNone, .scaling = 0, .enumStrings = enumStringsOnOff },
 };
 
 //static const uint8_t routingParams[] = { kParamOutput, kParamOutputMode };
 
 static const uint8_t page1[] = { FREQ_PARAM,
+    // Low frequency range (for modulation)
+    LFO_MODE_PARAM,
+    // Frequency input mode & depth (Linear/Through-Zero)
+    FM_MODE_PARAM,
+    FM_DEPTH_PARAM,
     // Number of outer vertices. 'Inner' vertices will be mapped in between, but by default will be in-line with the outer vertices.
     NUM_VERTICES_PARAM,
     // Angle offset for shape / Initial rotation
@@ -297,6 +446,8 @@ static const uint8_t page1[] = { FREQ_PARAM,
     INNER_VERTICES_RADIUS_PARAM,
     // Angle offset of the inner vertices. Default is 0 degrees from 180/N (mid).
     INNER_VERTICES_ANGLE_PARAM,
+    // Curvature of the edges
+    CURVATURE_PARAM,
     X_AMPLITUDE_PARAM,
     Y_AMPLITUDE_PARAM,
     X_OFFSET_PARAM,
@@ -308,14 +459,40 @@ static const uint8_t page1[] = { FREQ_PARAM,
     Y_C_ROTATION_PARAM,
     // Apply ABSOLUTE rotation or RELATIVE rotation (true/false)
     ROTATION_ABS_PARAM,
-    TOP_BAR_UI_PARAM
+    ANTI_ALIAS_PARAM,
+    TOP_BAR_UI_PARAM,
+    PREVIEW_PARAM,
+    DECAY_PARAM
 };
 // Page 2: Routing X output
-static const uint8_t page2[] = { kParamInput, kParamOutput, kParamOutputMode, kParamOutput2, kParamOutputMode2 };
+static const uint8_t page2[] = { kParamInput, kParamOutput, kParamOutputMode, kParamOutput2, kParamOutputMode2, kParamTriggerOutput, kParamBlankOutput, kParamMorphInput };
+// Page 3: Extra shapes
+static const uint8_t page3[] = { NUM_SHAPES_PARAM, SHAPE_SHARE_PARAM,
+    SHAPE2_NUM_VERTICES_PARAM, SHAPE2_SCALE_PARAM, SHAPE2_X_OFFSET_PARAM, SHAPE2_Y_OFFSET_PARAM, SHAPE2_ROTATION_PARAM,
+    SHAPE3_NUM_VERTICES_PARAM, SHAPE3_SCALE_PARAM, SHAPE3_X_OFFSET_PARAM, SHAPE3_Y_OFFSET_PARAM, SHAPE3_ROTATION_PARAM,
+    SHAPE4_NUM_VERTICES_PARAM, SHAPE4_SCALE_PARAM, SHAPE4_X_OFFSET_PARAM, SHAPE4_Y_OFFSET_PARAM, SHAPE4_ROTATION_PARAM
+};
+
+// Page 4: Corner trigger & blanking gate
+static const uint8_t page4[] = { TRIGGER_WIDTH_PARAM, BLANK_MODE_PARAM, BLANK_WIDTH_PARAM, BLANK_LEVEL_PARAM };
+
+// Page 5: Debug
+static const uint8_t page5[] = { TRACE_CAPTURE_PARAM, TRACE_EXPORT_PARAM };
+
+// Page 6: Quality tiers
+static const uint8_t page6[] = { QUALITY_PARAM, CPU_BUDGET_PARAM };
+
+// Page 7: Morph between stored snapshots
+static const uint8_t page7[] = { MORPH_PARAM, MORPH_AMOUNT_PARAM, MORPH_STORE_PARAM };
 
 static const _NT_parameterPage pages[] = {
 	{ .name = "Polygon", .numParams = ARRAY_SIZE(page1), .params = page1 },
-	{ .name = "Routing", .numParams = ARRAY_SIZE(page2), .params = page2 }
+	{ .name = "Routing", .numParams = ARRAY_SIZE(page2), .params = page2 },
+	{ .name = "Shapes", .numParams = ARRAY_SIZE(page3), .params = page3 },
+	{ .name = "Gates", .numParams = ARRAY_SIZE(page4), .params = page4 },
+	{ .name = "Debug", .numParams = ARRAY_SIZE(page5), .params = page5 },
+	{ .name = "Quality", .numParams = ARRAY_SIZE(page6), .params = page6 },
+	{ .name = "Morph", .numParams = ARRAY_SIZE(page7), .params = page7 }
 };
 
 static const _NT_parameterPages parameterPages = {
@@ -323,124 +500,387 @@ static const _NT_parameterPages parameterPages = {
 	.pages = pages,
 };
 
+// Specification ids/indices
+enum SpecificationIds : uint8_t
+{
+    // Debug trace buffer size (KB)
+    kSpecTraceKB
+};
+
+static const _NT_specification specifications[] = {
+    { .name = "Trace buffer (KB)", .min = 0, .max = TS_POLYGEN_TRACE_KB_MAX, .def = 0, .type = kNT_typeGeneric },
+};
+
 void	calculateRequirements( _NT_algorithmRequirements& req, const int32_t* specifications )
 {
 	req.numParameters = ARRAY_SIZE(parameters);
 	req.sram = sizeof(_polyGenAlgorithm);
-	req.dram = 0;
+	// Engine tables (shapes, snapshots & morph, cached cycle), the persistence image, then the trace buffer
+	req.dram = _polyGenEngine::memorySize() + TS_POLYGEN_SCREEN_BYTES;
+	if (specifications != NULL)
+		req.dram += specifications[kSpecTraceKB] * 1024;
 	req.dtc = 0;
 	req.itc = 0;
 }
 
+// CPU cycle counter (Cortex-M7 DWT) for timing step(). 0 if we aren't on the module.
+static inline uint32_t cycleCount()
+{
+#if defined(__arm__)
+    return *((volatile uint32_t*)0xE0001004);
+#else
+    return 0;
+#endif
+}
+
+// Start the cycle counter if nothing else has: trace enable (DEMCR.TRCENA), unlock the DWT, then DWT_CTRL.CYCCNTENA.
+// If it still doesn't count, the Auto quality governor sees that and falls back to a fixed tier.
+// NB: these are the core's own debug registers, shared with the firmware, other plugins and a debugger, so this is
+// a deliberate side effect outside polyGen. It is only done when CYCCNT isn't already counting (two reads in a row
+// differ when it is), so a counter someone else started (or is using) is never touched, and it is never turned off.
+static inline void cycleCountEnable()
+{
+#if defined(__arm__)
+    uint32_t first = cycleCount();
+    if (cycleCount() != first)
+        return; // Already running
+    volatile uint32_t* demcr = (volatile uint32_t*)0xE000EDFC;
+    volatile uint32_t* dwtCtrl = (volatile uint32_t*)0xE0001000;
+    if ((*demcr & (1u << 24)) == 0)
+        *demcr |= 1u << 24;
+    *((volatile uint32_t*)0xE0001FB0) = 0xC5ACCE55;
+    if ((*dwtCtrl & 1u) == 0)
+        *dwtCtrl |= 1u;
+#endif
+    return;
+}
+
 _NT_algorithm*	construct( const _NT_algorithmMemoryPtrs& ptrs, const _NT_algorithmRequirements& req,const int32_t* specifications )
 {
     //_polyGenAlgorithm* alg = new (ptrs.sram) _polyGenAlgorithm((_polyGenAlgorithm_DTC*)ptrs.dtc );
     _polyGenAlgorithm* alg = new (ptrs.sram) _polyGenAlgorithm();
+    uint8_t* dram = ptrs.dram;
+    alg->engine.setMemory(dram);
+    alg->engine.prepare(static_cast<float>(NT_globals.sampleRate));
+    cycleCountEnable();
+    dram += _polyGenEngine::memorySize();
+    alg->persistScreen = dram;
+    memset(alg->persistScreen, 0, TS_POLYGEN_SCREEN_BYTES);
+    dram += TS_POLYGEN_SCREEN_BYTES;
+    uint32_t traceSize = req.dram - (dram - ptrs.dram);
+    if (traceSize >= sizeof(_polyGenTraceHeader))
+    {
+        alg->traceBuffer = dram;
+        alg->traceSize = traceSize;
+        memset(alg->traceBuffer, 0, sizeof(_polyGenTraceHeader)); // No trace yet (nothing to save with the preset)
+    }
 	alg->parameters = parameters;
 	alg->parameterPages = &parameterPages;
 	return alg;
 }
 
-// Gets the frequency from the voltage (1V per octave)
-float getFrequencyFromVoltage(float voltage){
-    // 1V per Octave
-    return BASE_FREQ_HZ*powf(2.0f, voltage);
+// Hash of a block of X & Y output (FNV-1a over the float bits), to compare a replay against the capture.
+uint32_t traceHash(const float* x, const float* y, int numFrames)
+{
+    uint32_t hash = 2166136261u;
+    const float* outs[] = { x, y };
+    for (int ch = 0; ch < 2; ch++)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(outs[ch]);
+        for (int i = 0; i < numFrames * static_cast<int>(sizeof(float)); i++)
+        {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Reserve numBytes in the trace. NULL (and capture stops) if the buffer is full.
+// parameterChanged() (UI) can interrupt step() (audio) and vice versa, so the space is claimed in one atomic
+// update of the length: each caller gets its own bytes, in the order the records went in.
+uint8_t* traceReserve(_polyGenAlgorithm* pThis, uint32_t numBytes)
+{
+    _polyGenTraceHeader* header = reinterpret_cast<_polyGenTraceHeader*>(pThis->traceBuffer);
+    uint32_t length = __atomic_load_n(&(header->length), __ATOMIC_RELAXED);
+    do
+    {
+        if (length + numBytes > pThis->traceSize)
+        {
+            __atomic_fetch_or(&(header->flags), TS_POLYGEN_TRACE_FLAG_FULL, __ATOMIC_RELAXED);
+            pThis->traceCapture = false;
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&(header->length), &length, length + numBytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    return pThis->traceBuffer + length;
+}
+
+// Record a parameter change.
+void traceParameter(_polyGenAlgorithm* pThis, int p)
+{
+    uint8_t* record = traceReserve(pThis, 4);
+    if (record != NULL)
+    {
+        int16_t value = pThis->v[p];
+        record[0] = TRACE_PARAMETER;
+        record[1] = static_cast<uint8_t>(p);
+        memcpy(record + 2, &value, sizeof(value));
+    }
+    return;
+}
+
+// Record a block's input bus(es). Returns the record so the cycles & output hash can be filled in after the block.
+uint8_t* traceBlock(_polyGenAlgorithm* pThis, const float* busFrames, int numFrames)
+{
+    const uint8_t numChannels = ARRAY_SIZE(traceInputParams);
+    uint8_t* record = traceReserve(pThis, 16 + numChannels * numFrames * sizeof(float));
+    if (record != NULL)
+    {
+        uint16_t frames = static_cast<uint16_t>(numFrames);
+        record[0] = TRACE_BLOCK;
+        record[1] = numChannels;
+        memcpy(record + 2, &frames, sizeof(frames));
+        memset(record + 4, 0, 12);
+        record[12] = pThis->engine.getAutoTier(); // Measured on the module, so replay needs it
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            uint8_t* data = record + 16 + ch * numFrames * sizeof(float);
+            int bus = pThis->v[traceInputParams[ch]];
+            if (bus > 0)
+                memcpy(data, busFrames + ( bus - 1 ) * numFrames, numFrames * sizeof(float));
+            else
+                memset(data, 0, numFrames * sizeof(float)); // Optional input not routed
+        }
+    }
+    return record;
+}
+
+// Record the morph snapshots (they come from a preset or an earlier Store, not from the parameters).
+void traceSnapshots(_polyGenAlgorithm* pThis)
+{
+    for (int i = 0; i < TS_POLYGEN_SNAPSHOTS; i++)
+    {
+        const _polyGenSnapshot* snapshot = pThis->engine.snapshot(i);
+        uint16_t numPoints = static_cast<uint16_t>(snapshot->numPoints);
+        uint32_t tableBytes = numPoints * sizeof(_polyGenVec);
+        uint8_t* record = traceReserve(pThis, 8 + 3 * tableBytes);
+        if (record == NULL)
+            return;
+        record[0] = TRACE_SNAPSHOT;
+        record[1] = static_cast<uint8_t>(i);
+        record[2] = ((snapshot->stored) ? TRACE_SNAPSHOT_STORED : 0)
+            | ((snapshot->useCurves) ? TRACE_SNAPSHOT_CURVES : 0)
+            | ((pThis->engine.isStorePending(i)) ? TRACE_SNAPSHOT_PENDING : 0);
+        record[3] = 0;
+        memcpy(record + 4, &numPoints, sizeof(numPoints));
+        memset(record + 6, 0, 2);
+        memcpy(record + 8, snapshot->points, tableBytes);
+        memcpy(record + 8 + tableBytes, snapshot->lin, tableBytes);
+        memcpy(record + 8 + 2 * tableBytes, snapshot->quad, tableBytes);
+    }
+    return;
+}
+
+// Length of the trace cut to at most maxBytes, at the end of a whole record (so the saved trace still replays).
+uint32_t traceExportLength(const uint8_t* buffer, uint32_t length, uint32_t maxBytes)
+{
+    uint32_t pos = sizeof(_polyGenTraceHeader);
+    while (pos < length)
+    {
+        uint32_t size = 4;
+        if (buffer[pos] == TRACE_BLOCK)
+        {
+            uint16_t frames;
+            memcpy(&frames, buffer + pos + 2, sizeof(frames));
+            size = 16 + buffer[pos + 1] * frames * sizeof(float);
+        }
+        else if (buffer[pos] == TRACE_SNAPSHOT)
+        {
+            uint16_t numPoints;
+            memcpy(&numPoints, buffer + pos + 4, sizeof(numPoints));
+            size = 8 + 3 * numPoints * sizeof(_polyGenVec);
+        }
+        if (pos + size > maxBytes || pos + size > length)
+            break;
+        pos += size;
+    }
+    return pos;
+}
+
+void	parameterChanged( _NT_algorithm* self, int p );
+
+// Start a new trace: header, snapshots, then reset the state and record every parameter (as a replay would start).
+// Called from step(), between blocks, so the reset can't land in the middle of one.
+void traceStart(_polyGenAlgorithm* pThis)
+{
+    _polyGenTraceHeader* header = reinterpret_cast<_polyGenTraceHeader*>(pThis->traceBuffer);
+    header->magic = TS_POLYGEN_TRACE_MAGIC;
+    header->version = TS_POLYGEN_TRACE_VERSION;
+    header->numParameters = ARRAY_SIZE(parameters);
+    header->sampleRate = NT_globals.sampleRate;
+    header->length = sizeof(_polyGenTraceHeader);
+    header->flags = 0;
+    pThis->engine.reset();
+    pThis->traceCapture = true;
+    traceSnapshots(pThis);
+    // Spin first: Rotation is degrees or degrees/s depending on it
+    parameterChanged(pThis, ROTATION_ABS_PARAM);
+    for (int p = 0; p < static_cast<int>(ARRAY_SIZE(parameters)); p++)
+    {
+        // (Store Snapshot is an action, not a setting: the snapshots are already in the trace)
+        if (p != TRACE_CAPTURE_PARAM && p != TRACE_EXPORT_PARAM && p != MORPH_STORE_PARAM && p != ROTATION_ABS_PARAM)
+            parameterChanged(pThis, p);
+    }
+    return;
 }
 
 void	parameterChanged( _NT_algorithm* self, int p )
 {
 	_polyGenAlgorithm* pThis = (_polyGenAlgorithm*)self;
-    //_polyGenInputs* dtc = pThis->dtc;
+    _polyGenEngine* engine = &(pThis->engine);
+    const int16_t* v = pThis->v;
+
+    if (pThis->traceCapture && p != TRACE_CAPTURE_PARAM && p != TRACE_EXPORT_PARAM)
+        traceParameter(pThis, p);
    
     switch (p)
     {
         case ParamIds::FREQ_PARAM:
             // Frequency parameter
-            pThis->frequencyParam_V = static_cast<float>(pThis->v[FREQ_PARAM])/FREQ_SCALING;    
-            // clamp
-            pThis->frequencyParam_V = clamp(pThis->frequencyParam_V, static_cast<float>(TROWA_FREQ_KNOB_MIN), static_cast<float>(TROWA_FREQ_KNOB_MAX));
+            engine->setFrequency(static_cast<float>(v[FREQ_PARAM])/FREQ_SCALING);
+            break;
+        case ParamIds::FM_MODE_PARAM:
+            engine->setFMMode(static_cast<uint8_t>( v[FM_MODE_PARAM] ));
+            break;
+        case ParamIds::FM_DEPTH_PARAM:
+            engine->setFMDepth(static_cast<float>( v[FM_DEPTH_PARAM] ));
             break;
         case ParamIds::NUM_VERTICES_PARAM:
-            pThis->numVertices = static_cast<uint8_t>( pThis->v[NUM_VERTICES_PARAM] );
+            engine->setNumVertices(v[NUM_VERTICES_PARAM]);
             break;
         case ParamIds::ANGLE_OFFSET_PARAM:
-            pThis->angleOffset_rad = pThis->v[ANGLE_OFFSET_PARAM] * PI / 180.0f;
+            engine->setAngleOffset(static_cast<float>( v[ANGLE_OFFSET_PARAM] ));
             break;
         case ParamIds::ROTATION_ABS_PARAM:
-            pThis->rotationIsAbs = !(pThis->v[ROTATION_ABS_PARAM] > 0);
-            if (pThis->rotationIsAbs){
-                // Re-read the rotation parameter
-                pThis->rotation_deg = -1.0f * static_cast<float>(pThis->v[ROTATION_PARAM]);
-                // Just make rotation simplier (-360 to 360)
-                if (pThis->rotation_deg < -360 || pThis->rotation_deg > 360)
-                {
-                    int n = static_cast<int>( std::abs(pThis->rotation_deg) / 360.0f + 0.5f );
-                    if (pThis->rotation_deg >= 0.0f)
-                        pThis->rotation_deg -= (n * 360);
-                    else
-                        pThis->rotation_deg += (n * 360);
-                }
-                pThis->rotation_rad = pThis->rotation_deg / 180.0f * PI;   
-            }
+            engine->setSpin(v[ROTATION_ABS_PARAM] > 0);
             break;
         case ParamIds::INNER_VERTICES_RADIUS_PARAM:
-            pThis->innerRadiusMult = static_cast<float>(pThis->v[INNER_VERTICES_RADIUS_PARAM]) / 100.f; 
-            {
-                // See if we even have to worry about inner (2ndary) vertices (ignore if very close to 100%)
-                const float threshold = 0.0005f;
-                float radiusDiff = 1.0f - pThis->innerRadiusMult;
-                pThis->useInnerVerts = radiusDiff < -threshold || radiusDiff > threshold;
-            }
+            engine->setInnerRadius(static_cast<float>(v[INNER_VERTICES_RADIUS_PARAM]) / 100.f);
             break;
         case ParamIds::INNER_VERTICES_ANGLE_PARAM:
-            pThis->innerAngleMult = static_cast<float>(pThis->v[INNER_VERTICES_ANGLE_PARAM]) / 100.f;
+            engine->setInnerAngle(static_cast<float>(v[INNER_VERTICES_ANGLE_PARAM]) / 100.f);
             break;
         case ParamIds::X_AMPLITUDE_PARAM:
         case ParamIds::Y_AMPLITUDE_PARAM:
+            engine->setAmplitude(static_cast<float>(v[X_AMPLITUDE_PARAM])/VOLTAGE_SCALING, static_cast<float>(v[Y_AMPLITUDE_PARAM])/VOLTAGE_SCALING);
+            break;
         case ParamIds::X_OFFSET_PARAM:
         case ParamIds::Y_OFFSET_PARAM:
+            engine->setOffset(static_cast<float>(v[X_OFFSET_PARAM])/VOLTAGE_SCALING, static_cast<float>(v[Y_OFFSET_PARAM])/VOLTAGE_SCALING);
+            break;
         case ParamIds::X_C_ROTATION_PARAM:
         case ParamIds::Y_C_ROTATION_PARAM:
+            engine->setRotationCenter(static_cast<float>(v[X_C_ROTATION_PARAM])/VOLTAGE_SCALING, static_cast<float>(v[Y_C_ROTATION_PARAM])/VOLTAGE_SCALING);
+            break;
+        case ParamIds::ROTATION_PARAM:
+            // Degrees, or degrees/second while spinning
+            engine->setRotation(static_cast<float>(v[ROTATION_PARAM]));
+            break;
+        case ParamIds::TOP_BAR_UI_PARAM:
+            pThis->topBarOn = v[p] > 0;
+            break;
+        case ParamIds::PREVIEW_PARAM:
+            if (v[PREVIEW_PARAM] == PREVIEW_PERSISTENCE && pThis->previewMode != PREVIEW_PERSISTENCE)
             {
-                //=== * Amplitude, Offset for X & Y * ===
-                //const int numVoltageParams = 6;
-                float* vPtrs[] = { &(pThis->xAmpl), &(pThis->yAmpl), &(pThis->xOffset), &(pThis->yOffset), &(pThis->xCRot), &(pThis->yCRot) };
-                //int vParamIds[] = { X_AMPLITUDE_PARAM, Y_AMPLITUDE_PARAM, X_OFFSET_PARAM, Y_OFFSET_PARAM, X_C_ROTATION_PARAM, Y_C_ROTATION_PARAM };
-                (*(vPtrs[p - X_AMPLITUDE_PARAM])) = clamp(static_cast<float>(pThis->v[p])/VOLTAGE_SCALING, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+                memset(pThis->persistScreen, 0, TS_POLYGEN_SCREEN_BYTES); // Start without old trails
+                pThis->persistBox = _polyGenRasterBox();
             }
+            pThis->previewMode = static_cast<uint8_t>( v[PREVIEW_PARAM] );
             break;
-        case ParamIds::ROTATION_PARAM:
+        case ParamIds::DECAY_PARAM:
+            pThis->decay = static_cast<uint8_t>( v[DECAY_PARAM] );
+            break;
+        case ParamIds::CURVATURE_PARAM:
+            engine->setCurvature(static_cast<float>(v[CURVATURE_PARAM]) / 100.f);
+            break;
+        case ParamIds::ANTI_ALIAS_PARAM:
+            engine->setAntiAlias(v[ANTI_ALIAS_PARAM] > 0);
+            break;
+        case ParamIds::TRIGGER_WIDTH_PARAM:
+            engine->setTriggerWidth(static_cast<float>(v[TRIGGER_WIDTH_PARAM]) / 10.f);
+            break;
+        case ParamIds::BLANK_WIDTH_PARAM:
+        case ParamIds::BLANK_MODE_PARAM:
+        case ParamIds::BLANK_LEVEL_PARAM:
             {
-                //=== * Rotation * ===
-                float rot_deg = -1.0f * static_cast<float>(pThis->v[ROTATION_PARAM]);    
-                if (pThis->rotationIsAbs)
-                {
-                    pThis->rotation_deg = rot_deg;
-                }
-                else
-                {
-                    // Rotations is N deg/second
-                    // So need to reduce by sample rate
-                    uint32_t sRate = (NT_globals.sampleRate > 0) ? NT_globals.sampleRate : 1000;
-                    pThis->rotation_deg += rot_deg / static_cast<float>(sRate);
-                }
-                // Just make rotation simplier (-360 to 360)
-                if (pThis->rotation_deg < -360 || pThis->rotation_deg > 360)
-                {
-                    int n = static_cast<int>( std::abs(pThis->rotation_deg) / 360.0f + 0.5f );
-                    if (pThis->rotation_deg >= 0.0f)
-                        pThis->rotation_deg -= (n * 360);
-                    else
-                        pThis->rotation_deg += (n * 360);
-                }
-                pThis->rotation_rad = pThis->rotation_deg / 180.0f * PI;
-
+                static const uint8_t blankMasks[] = { EVENT_CORNER, EVENT_CORNER | EVENT_RETRACE, EVENT_RETRACE };
+                engine->setBlank(blankMasks[v[BLANK_MODE_PARAM]], static_cast<float>(v[BLANK_WIDTH_PARAM]) / 10.f, static_cast<float>(v[BLANK_LEVEL_PARAM])/VOLTAGE_SCALING);
             }
             break;
-        case ParamIds::TOP_BAR_UI_PARAM:
-            pThis->topBarOn = pThis->v[p] > 0;
+        case ParamIds::TRACE_CAPTURE_PARAM:
+            if (v[TRACE_CAPTURE_PARAM] > 0 && !pThis->traceCapture && pThis->traceBuffer != NULL)
+                pThis->traceStartPending = true;
+            else if (v[TRACE_CAPTURE_PARAM] == 0)
+                pThis->traceCapture = pThis->traceStartPending = false;
+            break;
+        case ParamIds::TRACE_EXPORT_PARAM:
+            pThis->traceExport = v[TRACE_EXPORT_PARAM] > 0;
+            break;
+        case ParamIds::QUALITY_PARAM:
+            engine->setQuality(static_cast<uint8_t>( v[QUALITY_PARAM] ));
+            break;
+        case ParamIds::CPU_BUDGET_PARAM:
+            engine->setCpuBudget(static_cast<float>(v[CPU_BUDGET_PARAM]) / 100.0f);
+            break;
+        case ParamIds::MORPH_PARAM:
+            engine->setMorph(v[MORPH_PARAM] > 0);
+            break;
+        case ParamIds::MORPH_AMOUNT_PARAM:
+            engine->setMorphAmount(static_cast<float>(v[MORPH_AMOUNT_PARAM]) / 1000.f);
+            break;
+        case ParamIds::MORPH_STORE_PARAM:
+            {
+                // Store on the change into A or B only (the value is left as it is, so to store into the same one
+                // again go through -). A CV/MIDI mapping stores on each step it makes into A or B.
+                bool store = v[MORPH_STORE_PARAM] > 0 && v[MORPH_STORE_PARAM] != pThis->morphStoreLast;
+                pThis->morphStoreLast = v[MORPH_STORE_PARAM];
+                if (store)
+                    engine->requestSnapshot(v[MORPH_STORE_PARAM] - 1);
+            }
+            break;
+        case ParamIds::LFO_MODE_PARAM:
+            engine->setLFO(v[LFO_MODE_PARAM] > 0);
+            break;
+        case ParamIds::NUM_SHAPES_PARAM:
+            engine->setNumShapes(v[NUM_SHAPES_PARAM]);
+            break;
+        case ParamIds::SHAPE_SHARE_PARAM:
+            engine->setShapeShare(v[SHAPE_SHARE_PARAM] > 0);
             break;
         default:
+            if (p >= SHAPE2_NUM_VERTICES_PARAM && p <= SHAPE4_ROTATION_PARAM)
+            {
+                //=== * Extra shapes (2 to N) * ===
+                int shapeIx = 1 + (p - SHAPE2_NUM_VERTICES_PARAM) / SHAPE_NUM_PARAMS;
+                int shapeParam0 = SHAPE2_NUM_VERTICES_PARAM + (shapeIx - 1) * SHAPE_NUM_PARAMS;
+                switch (p - shapeParam0)
+                {
+                    case SHAPE2_NUM_VERTICES_PARAM - SHAPE2_NUM_VERTICES_PARAM:
+                        engine->setShapeSides(shapeIx, v[p]);
+                        break;
+                    case SHAPE2_SCALE_PARAM - SHAPE2_NUM_VERTICES_PARAM:
+                        engine->setShapeScale(shapeIx, static_cast<float>(v[p]) / 100.f);
+                        break;
+                    case SHAPE2_X_OFFSET_PARAM - SHAPE2_NUM_VERTICES_PARAM:
+                    case SHAPE2_Y_OFFSET_PARAM - SHAPE2_NUM_VERTICES_PARAM:
+                        engine->setShapeOffset(shapeIx, static_cast<float>(v[shapeParam0 + SHAPE2_X_OFFSET_PARAM - SHAPE2_NUM_VERTICES_PARAM])/VOLTAGE_SCALING,
+                            static_cast<float>(v[shapeParam0 + SHAPE2_Y_OFFSET_PARAM - SHAPE2_NUM_VERTICES_PARAM])/VOLTAGE_SCALING);
+                        break;
+                    case SHAPE2_ROTATION_PARAM - SHAPE2_NUM_VERTICES_PARAM:
+                        engine->setShapeRotation(shapeIx, static_cast<float>(v[p]));
+                        break;
+                }
+            }
             break;
     }
     return;
@@ -449,277 +889,242 @@ void	parameterChanged( _NT_algorithm* self, int p )
 void 	step( _NT_algorithm* self, float* busFrames, int numFramesBy4 )
 {
 	_polyGenAlgorithm* pThis = (_polyGenAlgorithm*)self;
-    //_polyGenInputs* dtc = pThis->dtc;
+    _polyGenEngine* engine = &(pThis->engine);
     int numFrames = numFramesBy4 * 4;
 
+    // Debug trace (record the input before we write any outputs)
+    if (pThis->traceStartPending)
+    {
+        pThis->traceStartPending = false;
+        traceStart(pThis);
+    }
+    uint8_t* traceRecord = (pThis->traceCapture) ? traceBlock(pThis, busFrames, numFrames) : NULL;
+    uint32_t startCycles = cycleCount();
+
+    if (engine->getSampleRate() != static_cast<float>(NT_globals.sampleRate) && NT_globals.sampleRate > 0)
+        engine->prepare(static_cast<float>(NT_globals.sampleRate));
 
-    
-    //=== * Timing/Frequency *===
-    float freq = pThis->frequencyParam_V;
+    //=== * Busses * ===
     const float* in = busFrames + ( pThis->v[kParamInput] - 1 ) * numFrames;
     float* out1 = busFrames + ( pThis->v[kParamOutput] - 1 ) * numFrames;
     float* out2 = busFrames + ( pThis->v[kParamOutput2] - 1 ) * numFrames;
+    // Optional gate outputs (nothing to do if neither is routed)
+    float* outTrigger = ( pThis->v[kParamTriggerOutput] > 0 ) ? busFrames + ( pThis->v[kParamTriggerOutput] - 1 ) * numFrames : NULL;
+    float* outBlank = ( pThis->v[kParamBlankOutput] > 0 ) ? busFrames + ( pThis->v[kParamBlankOutput] - 1 ) * numFrames : NULL;
+    engine->setEventsEnabled(outTrigger != NULL || outBlank != NULL);
+    // Morph input is read once per block (the end of it)
+    const float* morphIn = ( pThis->v[kParamMorphInput] > 0 ) ? busFrames + ( pThis->v[kParamMorphInput] - 1 ) * numFrames : NULL;
+    engine->setMorphCV((morphIn != NULL) ? morphIn[numFrames - 1] : 0.0f);
+
+    engine->process(in, out1, out2, numFrames);
+    engine->renderGates(outTrigger, outBlank, numFrames);
+
+    uint32_t cycles = cycleCount() - startCycles;
+    engine->updateGovernor(cycles, numFrames);
+    if (traceRecord != NULL)
+    {
+        uint32_t hash = traceHash(out1, out2, numFrames);
+        memcpy(traceRecord + 4, &cycles, sizeof(cycles));
+        memcpy(traceRecord + 8, &hash, sizeof(hash));
+    }
 
-    for (int frame = 0; frame < numFrames; ++frame)
+    return;    
+}
+
+//=== * Preview Rasterizer * ===
+// NT_screen is 256x64, 4 bits per pixel, 2 pixels per byte (left pixel in the high nibble).
+// Cheaper than NT_drawShapeF (no antialiasing), so more of the CPU is left for audio.
+
+// Set a pixel, keeping the brighter of the old and new colour (so lines crossing don't darken each other).
+static inline void rasterPixel(uint8_t* screen, int x, int y, uint8_t colour)
+{
+    uint8_t* byte = screen + y * (TS_POLYGEN_SCREEN_WIDTH / 2) + (x >> 1);
+    if (x & 1)
     {
-        //=== * Rotation * ===
-        if (!pThis->rotationIsAbs)
-        {
-            //----------------------------------------------------------
-            // Current rotation needs to be calculated every time then.
-            //----------------------------------------------------------
-            // Rotations is N deg/second
-            // So need to reduce by sample rate
-            float rot_deg = -1.0f * static_cast<float>(pThis->v[ROTATION_PARAM]);    
-            uint32_t sRate = (NT_globals.sampleRate > 0) ? NT_globals.sampleRate : 1000;
-            pThis->rotation_deg += rot_deg / static_cast<float>(sRate);
-
-            // Just make rotation simplier (-360 to 360)
-            if (pThis->rotation_deg < -360 || pThis->rotation_deg > 360)
-            {
-                int n = static_cast<int>( std::abs(pThis->rotation_deg) / 360.0f + 0.5f );
-                if (pThis->rotation_deg >= 0.0f)
-                    pThis->rotation_deg -= (n * 360);
-                else
-                    pThis->rotation_deg += (n * 360);
-            }
-            pThis->rotation_rad = pThis->rotation_deg / 180.0f * PI;
-        }
-        //=== * Main Clock * ===
-        // Main Clock:
-        float vertexTime, nextVertexTime; // Normalized 0 to 1 time for vertices.
-
-        float input = in[frame] + freq;
-        input = clamp(input, static_cast<float>(TROWA_FREQ_KNOB_MIN), static_cast<float>(TROWA_FREQ_KNOB_MAX));
-        float f = powf(2.0f, input) * BASE_FREQ_HZ * pThis->numVertices;
-        
-        // Want to draw N polygons per second (so multiply by # vertices):
-        float clockTime = f;//   powf(2.0, input) * TROWA_FREQ_KNOB_MULT * pThis->numVertices;
-        float dt = clockTime / NT_globals.sampleRate; // Real dt
-        pThis->phase += dt; // Main vertex phase
-        pThis->innerPhase += dt; // 2ndary/Inner vertex phase
-        
-        // Check for Next Side/Vertex
-        bool newCorner = false;
-        bool syncIn = false;
-
-        if (pThis->innerPhase >= 1.0f)
+        if ((*byte & 0x0F) < colour)
+            *byte = (*byte & 0xF0) | colour;
+    }
+    else
+    {
+        if ((*byte >> 4) < colour)
+            *byte = (*byte & 0x0F) | (colour << 4);
+    }
+    return;
+}
+
+// Clip a line to the screen (Liang-Barsky). Returns false if none of it is on the screen.
+bool rasterClip(float& x0, float& y0, float& x1, float& y1)
+{
+    float t0 = 0.0f, t1 = 1.0f;
+    float dx = x1 - x0, dy = y1 - y0;
+    const float p[4] = { -dx, dx, -dy, dy };
+    const float q[4] = { x0, TS_POLYGEN_SCREEN_WIDTH - 1 - x0, y0, TS_POLYGEN_SCREEN_HEIGHT - 1 - y0 };
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0.0f)
         {
-            pThis->innerPhase = 0.0f;
+            if (q[i] < 0.0f)
+                return false; // Parallel to this edge and outside it
         }
-        
-        if (pThis->phase >= 1.0f || syncIn)
+        else
         {
-            if (syncIn)
+            float t = q[i] / p[i];
+            if (p[i] < 0.0f)
             {
-                pThis->phase = 0.0f;
-                pThis->currVertexIx = 0;
+                if (t > t1)
+                    return false;
+                if (t > t0)
+                    t0 = t;
             }
             else
             {
-                pThis->phase -= 1.0f; // (Soft) Reset main clock phase
-                pThis->currVertexIx++;
+                if (t < t0)
+                    return false;
+                if (t < t1)
+                    t1 = t;
             }
-            newCorner = true;
-            
-            if (pThis->currVertexIx >= pThis->numVertices)
-                pThis->currVertexIx = 0;
-
-            pThis->innerPhase = 0; // (Hard) Reset inner/2ndary phase (for inner/2ndary vertices)
-            pThis->innerSideIx = 0; // Reset the side we are on (for inner/2ndary vertices)
         }
+    }
+    x1 = x0 + t1 * dx;
+    y1 = y0 + t1 * dy;
+    x0 += t0 * dx;
+    y0 += t0 * dy;
+    return true;
+}
 
-        // Which vertex we are on (outer/main)
-        if (pThis->currVertexIx >= pThis->numVertices)
-            pThis->currVertexIx = 0;
-        pThis->nextVertexIx = pThis->currVertexIx + 1;
-        if (pThis->nextVertexIx >= pThis->numVertices)
-            pThis->nextVertexIx = 0;
-
-        //=======================================
-        // Calculate the 2 vertices we will use
-        //=======================================
-        
-        // Time/Phase for sin
-        vertexTime = static_cast<float>(pThis->currVertexIx) / static_cast<float>(pThis->numVertices);
-        nextVertexTime = static_cast<float>(pThis->nextVertexIx) / static_cast<float>(pThis->numVertices);
-        
-        float v1Time = vertexTime;
-        float v2Time = nextVertexTime;
-        Vec v1Ampl = Vec(pThis->xAmpl, pThis->yAmpl);
-        Vec v2Ampl = Vec(pThis->xAmpl, pThis->yAmpl);
-        float linearPhase = clamp(pThis->phase, 0.0f, 1.0f); // For interpolation
-        Vec thisCorner, nextCorner;
-        
-        //---------------------
-        // This Corner/Vertex
-        //---------------------
-        thisCorner.x = v1Ampl.x * SINFUNC( 2 * PI * v1Time + pThis->angleOffset_rad);
-        thisCorner.y = v1Ampl.y * COSFUNC( 2 * PI * v1Time + pThis->angleOffset_rad);
-
-        //------------------------
-        // The Next Corner/Vertex
-        //------------------------
-        nextCorner.x = v2Ampl.x * SINFUNC( 2 * PI * v2Time + pThis->angleOffset_rad);
-        nextCorner.y = v2Ampl.y * COSFUNC( 2 * PI * v2Time + pThis->angleOffset_rad);
-        
-        if (pThis->useInnerVerts)
-        {
-            // Inject inner/2ndary vertex
-            float iTime = 0.5f * (1 + pThis->innerAngleMult);
-                    
-            // Use our inner/2ndary phase to see where we are
-            linearPhase = clamp(pThis->innerPhase, 0.0f, 1.0f);
-            
-#if TS_POLYGEN_IRADIUS_REL_2_MID_POINT
-            // Calculate the point on the line between the two corners
-            float midX = thisCorner.x + (nextCorner.x - thisCorner.x) * 0.5f;
-            float midY = thisCorner.y + (nextCorner.y - thisCorner.y) * 0.5f;
-            float ampl = SQRTFUNC(midX * midX + midY * midY) * pThis->innerRadiusMult;
-#endif
-            if (linearPhase < 0.5f)
-            {
-                // First Vertex then this middle inner one
-                v2Time = vertexTime + iTime/pThis->numVertices;
-#if TS_POLYGEN_IRADIUS_REL_2_MID_POINT
-                v2Ampl.x = ampl * SGN(v2Ampl.x);
-                v2Ampl.y = ampl * SGN(v2Ampl.y);
-#else
-                v2Ampl.x *= pThis->innerRadiusMult;
-                v2Ampl.y *= pThis->innerRadiusMult;
-#endif
-                linearPhase = linearPhase / iTime; // Rescale 0 to 1
-                nextCorner.x = v2Ampl.x * SINFUNC( 2 * PI * v2Time + pThis->angleOffset_rad);
-                nextCorner.y = v2Ampl.y * COSFUNC( 2 * PI * v2Time + pThis->angleOffset_rad);
-            }
-            else
-            {
-                // This middle inner one and then the 2nd vertex
-                v1Time = vertexTime + iTime / pThis->numVertices;
-#if TS_POLYGEN_IRADIUS_REL_2_MID_POINT
-                v1Ampl.x = ampl * SGN(v1Ampl.x);
-                v1Ampl.y = ampl * SGN(v1Ampl.y);
-#else
-                v1Ampl.x *= pThis->innerRadiusMult;
-                v1Ampl.y *= pThis->innerRadiusMult;
-#endif
-                linearPhase = (linearPhase - 0.5f) / 0.5f;    // Rescale 0 to 1
-                thisCorner.x = v1Ampl.x * SINFUNC( 2 * PI * v1Time + pThis->angleOffset_rad);
-                thisCorner.y = v1Ampl.y * COSFUNC( 2 * PI * v1Time + pThis->angleOffset_rad);
-            }
-        } // end if inner/2ndary vertices
-        
-        //===============================
-        // Interpolate this step's value
-        //===============================
-        // Interpolate based on which point we are on this side
-        float vx = thisCorner.x;
-        float vy = thisCorner.y;
-        if (!newCorner)
+// Grow box to take in the pixels from (x0, y0) to (x1, y1).
+static inline void rasterBoxAdd(_polyGenRasterBox& box, int x0, int y0, int x1, int y1)
+{
+    int top = (y0 < y1) ? y0 : y1, bottom = (y0 < y1) ? y1 : y0;
+    int left = ((x0 < x1) ? x0 : x1) >> 3, right = ((x0 < x1) ? x1 : x0) >> 3;
+    if (top < box.top)
+        box.top = top;
+    if (bottom > box.bottom)
+        box.bottom = bottom;
+    if (left < box.left)
+        box.left = left;
+    if (right > box.right)
+        box.right = right;
+    return;
+}
+
+// Draw a line (Bresenham, clipped to the screen). If box isn't NULL, it grows to take in the line.
+void rasterLine(uint8_t* screen, float fx0, float fy0, float fx1, float fy1, uint8_t colour, _polyGenRasterBox* box)
+{
+    if (!rasterClip(fx0, fy0, fx1, fy1))
+        return;
+    int x0 = static_cast<int>(fx0 + 0.5f), y0 = static_cast<int>(fy0 + 0.5f);
+    int x1 = static_cast<int>(fx1 + 0.5f), y1 = static_cast<int>(fy1 + 0.5f);
+    if (box != NULL)
+        rasterBoxAdd(*box, x0, y0, x1, y1);
+    int dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+    int dy = (y1 > y0) ? y0 - y1 : y1 - y0; // Negative
+    int sx = (x0 < x1) ? 1 : -1;
+    int sy = (y0 < y1) ? 1 : -1;
+    int err = dx + dy;
+    while (true)
+    {
+        rasterPixel(screen, x0, y0, colour);
+        if (x0 == x1 && y0 == y1)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy)
         {
-            // We don't have to interpolate if it is a new corner, otherwise simple linear interpolation
-            float mult = clamp(linearPhase, 0.0f, 1.0f);
-            vx += (nextCorner.x - thisCorner.x) * mult;
-            vy += (nextCorner.y - thisCorner.y) * mult;
+            err += dy;
+            x0 += sx;
         }
-        
-        //===============================
-        // Rotate the point
-        //===============================
-        float vxR, vyR;
-        vxR = vx;
-        vyR = vy;
-        
-        if (pThis->rotation_deg != 0 && pThis->rotation_deg != 360)
+        if (e2 <= dx)
         {
-            float sinrot = SINFUNC( pThis->rotation_rad );
-            float cosrot = COSFUNC( pThis->rotation_rad );
-            
-            // Translate to rotation center
-            vx -= pThis->xCRot;
-            vy -= pThis->yCRot;
-            
-            // Rotate
-            vxR = vx * cosrot - vy * sinrot;
-            vyR = vx * sinrot + vy * cosrot;
-            
-            // Translate back after rotation
-            vxR += pThis->xCRot;
-            vyR += pThis->yCRot;
+            err += dx;
+            y0 += sy;
         }
-        
-        //================================
-        // Post Rotation Offset
-        //================================
-        vxR += pThis->xOffset;
-        vyR += pThis->yOffset;
-
-        //================================
-        // Outputs
-        //================================
-        
-        // CHANNEL 0 (X)
-        uint8_t ch = 0;
-        out1[frame] = vxR;
-        // CHANNEL 1 (Y)
-        ch = 1;
-        out2[frame] = vyR;
     }
-
-    // for ( uint32_t ch=0; ch < 2; ++ch )
-	// {
-    //     for ( int i = 0; i < numFrames; ++i )
-    //     {
-    //         out[i] = (ch == 1) ? vyR : vxR ;
-    //     }
-	// 	out += numFrames;
-	// }
-    // float* out = busFrames + ( pThis->v[kParamOutput] - 1 ) * numFrames;
-    // for ( uint32_t ch=0; ch < 2; ++ch )
-	// {
-    //     for ( int i = 0; i < numFrames; ++i )
-    //     {
-    //         out[i] = (ch == 1) ? vyR : vxR ;
-    //     }
-	// 	out += numFrames;
-	// }
-
-    return;    
+    return;
 }
 
-void drawShape(Vec* buffer, int bufferLen, Vec offset, float mult, float lWidth, int lColor)
+// Fade the image inside box by amount levels (each nibble stops at 0), then shrink box to what is still lit
+// (outside it the image is already dark).
+// 8 pixels at a time: the even and odd nibbles are split into 8-bit lanes so each lane has a spare bit to borrow from.
+void rasterDecay(uint8_t* screen, int amount, _polyGenRasterBox& box)
 {
-    //NT_drawShapeF( _NT_shape shape, float x0, float y0, float x1, float y1, float colour=15 );
-    float x, y, lastX, lastY;
-	for (int v = 0; v < bufferLen; v++)
-	{
-        x = mult*buffer[v].x + offset.x;
-        y = mult*buffer[v].y + offset.y;
-		if (v > 0)
+    uint32_t* words = reinterpret_cast<uint32_t*>(screen);
+    uint32_t sub = static_cast<uint32_t>(amount) * 0x01010101u;
+    _polyGenRasterBox lit;
+    for (int row = box.top; row <= box.bottom; row++)
+    {
+        uint32_t* rowWords = words + row * (TS_POLYGEN_SCREEN_WIDTH / 8);
+        for (int i = box.left; i <= box.right; i++)
         {
-            NT_drawShapeF(kNT_line, lastX, lastY, x, y, lColor);
+            uint32_t w = rowWords[i];
+            if (w == 0)
+                continue;
+            uint32_t lo = (w & 0x0F0F0F0Fu) + 0x10101010u - sub;
+            uint32_t hi = ((w >> 4) & 0x0F0F0F0Fu) + 0x10101010u - sub;
+            // Lanes that didn't borrow keep their difference, the rest go to 0
+            lo &= ((lo & 0x10101010u) >> 4) * 0x0F;
+            hi &= ((hi & 0x10101010u) >> 4) * 0x0F;
+            w = lo | (hi << 4);
+            rowWords[i] = w;
+            if (w != 0)
+            {
+                if (row < lit.top)
+                    lit.top = row;
+                lit.bottom = row;
+                if (i < lit.left)
+                    lit.left = i;
+                if (i > lit.right)
+                    lit.right = i;
+            }
         }
-        else 
+    }
+    box = lit;
+    return;
+}
+
+// Max of each 4-bit value in 8-bit lanes (values 0 to 15 in the low nibble of each lane).
+static inline uint32_t rasterMaxLanes(uint32_t a, uint32_t b)
+{
+    uint32_t aGreaterEq = ((((a | 0x10101010u) - b) & 0x10101010u) >> 4) * 0x0F;
+    return (a & aGreaterEq) | (b & ~aGreaterEq);
+}
+
+// Copy the part of an image inside box (the rest is dark) onto the screen, keeping the brighter pixel of the two.
+void rasterBlend(uint8_t* screen, const uint8_t* image, const _polyGenRasterBox& box)
+{
+    for (int row = box.top; row <= box.bottom; row++)
+    {
+        uint32_t* dst = reinterpret_cast<uint32_t*>(screen) + row * (TS_POLYGEN_SCREEN_WIDTH / 8);
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(image) + row * (TS_POLYGEN_SCREEN_WIDTH / 8);
+        for (int i = box.left; i <= box.right; i++)
         {
-            // Go from the last point to the first point
-            lastX = mult*buffer[bufferLen - 1].x + offset.x;
-            lastY = mult*buffer[bufferLen - 1].y + offset.y;
-            NT_drawShapeF(kNT_line, lastX, lastY, x, y, lColor);
+            uint32_t s = src[i];
+            if (s == 0)
+                continue;
+            uint32_t d = dst[i];
+            uint32_t lo = rasterMaxLanes(s & 0x0F0F0F0Fu, d & 0x0F0F0F0Fu);
+            uint32_t hi = rasterMaxLanes((s >> 4) & 0x0F0F0F0Fu, (d >> 4) & 0x0F0F0F0Fu);
+            dst[i] = lo | (hi << 4);
         }
-        lastX = x;
-        lastY = y;
-	} // end loop through vertices
-    // x = mult*buffer[0].x + offset.x;
-    // y = mult*buffer[0].y + offset.y;
-    // NT_drawShapeF(kNT_line, lastX, lastY, x, y, lColor);
-	return;
+    }
+    return;
 }
 
-#define SHOW_RAW_BUFFER     0
+// Draw a line. With raster NULL, uses the NT's (antialiased) lines, otherwise our rasterizer into raster
+// (growing box, if it isn't NULL).
+static inline void drawLine(float x0, float y0, float x1, float y1, int lColor, uint8_t* raster, _polyGenRasterBox* box)
+{
+    //NT_drawShapeF( _NT_shape shape, float x0, float y0, float x1, float y1, float colour=15 );
+    if (raster != NULL)
+        rasterLine(raster, x0, y0, x1, y1, static_cast<uint8_t>( (lColor > 15) ? 15 : lColor ), box);
+    else
+        NT_drawShapeF(kNT_line, x0, y0, x1, y1, lColor);
+    return;
+}
 
 bool	draw( _NT_algorithm* self )
 {
 	_polyGenAlgorithm* pThis = (_polyGenAlgorithm*)self;
+    _polyGenEngine* engine = &(pThis->engine);
 	
 	// for ( int i=0; i<pThis->v[kParamGain]; ++i )
 	// 	NT_screen[ 128 * 20 + i ] = 0xa5;
@@ -733,24 +1138,16 @@ bool	draw( _NT_algorithm* self )
 	//NT_drawShapeF( kNT_line, 20, 50, 50, 60 );
 
     // screen is 256x64 - each byte contains two pixels
-    Vec boxSize = Vec(256, 64);
+    _polyGenVec boxSize = _polyGenVec(256, 64);
     float padding = 2.0f;
-    int lineWidth = 1;
     int lineColor = 17;
 
 
-    int numVertices = pThis->numVertices;// TS_POLYGEN_VERTICES_DEF;
-	float innerRadiusMult = pThis->innerRadiusMult;// TS_POLYGEN_INNER_RADIUS_MULT_DEF;
-	float innerAngleMult = pThis->innerAngleMult;// TS_POLYGEN_INNER_OFFSET_DEG_DEF;
-	float xAmpl = pThis->xAmpl;// TS_POLYGEN_AMPL_DEF;
-	float yAmpl = pThis->yAmpl;// TS_POLYGEN_AMPL_DEF;
-	bool useInnerVerts = pThis->useInnerVerts;
-	float rotation_rad = pThis->rotation_rad;// 0.0f;
-	float angleOffset_rad = pThis->angleOffset_rad;// 0.0f;
+	float rotation_rad = engine->getRotation();// 0.0f;
 	float in_range[2] = { TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX };
-	Vec rotCenter = Vec(pThis->xCRot, pThis->yCRot);
-	float xOff = pThis->xOffset;
-	float yOff = pThis->yOffset;
+	_polyGenVec rotCenter = engine->getRotationCenter();
+	float xOff = engine->getOffset().x;
+	float yOff = engine->getOffset().y;
 
     // Calculate canvas box dimension
 	float canvasCenterX = boxSize.x / 2.0f; // Center (0, 0)
@@ -766,161 +1163,242 @@ bool	draw( _NT_algorithm* self )
 		dim = boxSize.y;
 	}
 	dim -= padding * 2;
-	// Rescale amplitudes to fit in box
+	// Rescale to fit in box
 	float canvasRadius = dim / 2.0f;
-	xAmpl = scale(xAmpl, in_range[0], in_range[1], -canvasRadius, canvasRadius);
-	yAmpl = scale(-yAmpl, in_range[0], in_range[1], -canvasRadius, canvasRadius); // invert Y
 	rotCenter.x = scale(rotCenter.x, in_range[0], in_range[1], -canvasRadius, canvasRadius);
 	rotCenter.y = scale(-rotCenter.y, in_range[0], in_range[1], -canvasRadius, canvasRadius);	 // invert Y
 	xOff = scale(xOff, in_range[0], in_range[1], -canvasRadius, canvasRadius);
 	yOff = scale(-yOff, in_range[0], in_range[1], -canvasRadius, canvasRadius); // invert Y
-	Vec innerAmpl = Vec(xAmpl * innerRadiusMult, yAmpl * innerRadiusMult);
 
 	//============================
-	// Calculate the Buffers
+	// Calculate the points (from the pre-computed shape tables)
 	//============================
-	Vec nextPoint;
-	bool nextPointCalc = false;
-	float sinrot = SINFUNC(rotation_rad);
-	float cosrot = COSFUNC(rotation_rad);
-	float n = static_cast<float>(numVertices);
-	float innerAngleShift = 0.5f * (1 + innerAngleMult) / n;
-	int ix = 0;
-	Vec maxVals = Vec(0, 0);
-
-	int numPoints = (useInnerVerts) ? numVertices * 2 : numVertices;
-#if SHOW_RAW_BUFFER
-    Vec rawBuffer[BUFF_SIZE];
-#else
-    Vec rawPoint0;
-#endif
-    Vec rotatedBuffer[BUFF_SIZE];
+	float sinrot = TS_POLYGEN_SINFUNC(rotation_rad);
+	float cosrot = TS_POLYGEN_COSFUNC(rotation_rad);
+    _polyGenVec offset = _polyGenVec(canvasCenterX + xOff, canvasCenterY + yOff);
+    // Where the lines go (NULL for the NT's own lines)
+    uint8_t* raster = NULL;
+    _polyGenRasterBox* box = NULL;   // Persistence: where the image is lit (only that part is faded & blended)
+    if (pThis->previewMode == PREVIEW_FAST)
+    {
+        raster = NT_screen;
+    }
+    else if (pThis->previewMode == PREVIEW_PERSISTENCE)
+    {
+        raster = pThis->persistScreen;
+        box = &(pThis->persistBox);
+        rasterDecay(raster, pThis->decay, *box);
+    }
 
-	for (int v = 0; v < numVertices; v++)
+	for (int s = 0; s < engine->getNumShapes(); s++)
 	{
-		Vec point;
-		float pAngle = static_cast<float>(v) / n;
-		if (nextPointCalc)
-		{
-			point = nextPoint;
-		}
-		else
+		const _polyGenShape* shape = engine->getDrawnShape(s);
+		// Resolved (morph) shapes already have the main rotation/offset
+		float shapeSin = (shape->resolved) ? 0.0f : sinrot;
+		float shapeCos = (shape->resolved) ? 1.0f : cosrot;
+		_polyGenVec shapeOffset = (shape->resolved) ? _polyGenVec(canvasCenterX, canvasCenterY) : offset;
+		// Curved edges are split into a few lines (fewer when there are lots of edges already)
+		int pointsPerEdge = 1;
+		if (shape->useCurves && shape->numPoints > 0)
 		{
-			point.x = xAmpl * SINFUNC(pAngle * 2 * PI + angleOffset_rad);
-			point.y = yAmpl * COSFUNC(pAngle * 2 * PI + angleOffset_rad);
+			pointsPerEdge = TS_POLYGEN_DRAW_MAX_LINES / shape->numPoints;
+			if (pointsPerEdge > TS_POLYGEN_CURVE_DRAW_STEPS)
+				pointsPerEdge = TS_POLYGEN_CURVE_DRAW_STEPS;
+			else if (pointsPerEdge < 1)
+				pointsPerEdge = 1;
 		}
-		// Non-Rotated
-#if SHOW_RAW_BUFFER        
-		rawBuffer[ix].x = point.x;
-		rawBuffer[ix].y = point.y;
-#else
-        if (ix == 0)
-        {
-            rawPoint0 = point;
-        }
-#endif
-		if (point.x < 0 && -point.x > maxVals.x)
-			maxVals.x = -point.x;
-		else if (point.x > maxVals.x)
-			maxVals.x = point.x;
-		if (point.y < 0 && -point.y > maxVals.y)
-			maxVals.y = -point.y;
-		else if (point.y > maxVals.y)
-			maxVals.y = point.y;
-
-		// Rotate
-		rotatedBuffer[ix].x = (point.x - rotCenter.x) * cosrot + (point.y - rotCenter.y) * sinrot + rotCenter.x;
-		rotatedBuffer[ix].y = (-point.x - rotCenter.y) * sinrot + (point.y - rotCenter.y) * cosrot + rotCenter.y;
-		ix++;
-
-		if (useInnerVerts)
+		int numPoints = shape->numPoints * pointsPerEdge; // 0 until step() has built the tables
+		_polyGenVec first, last;
+		for (int ix = 0; ix < numPoints; ix++)
 		{
-			//------------------------
-			// Calculate 2ndary point
-			//------------------------
-#if TS_POLYGEN_IRADIUS_REL_2_MID_POINT
-			// Find amplitude/radius of mid point between the two corners
-			int v2 = v + 1;
-			if (v2 >= numVertices)
+			// Point on the edge
+			int edgeIx = ix / pointsPerEdge;
+			float t = static_cast<float>(ix - edgeIx * pointsPerEdge) / pointsPerEdge;
+			_polyGenVec point = shape->points[edgeIx];
+			point.x += (shape->lin[edgeIx].x + shape->quad[edgeIx].x * t) * t;
+			point.y += (shape->lin[edgeIx].y + shape->quad[edgeIx].y * t) * t;
+			point.x = scale(point.x, in_range[0], in_range[1], -canvasRadius, canvasRadius);
+			point.y = scale(-point.y, in_range[0], in_range[1], -canvasRadius, canvasRadius); // invert Y
+			// Rotate & Translate
+			_polyGenVec screenPoint;
+			screenPoint.x = (point.x - rotCenter.x) * shapeCos + (point.y - rotCenter.y) * shapeSin + rotCenter.x + shapeOffset.x;
+			screenPoint.y = (-point.x - rotCenter.y) * shapeSin + (point.y - rotCenter.y) * shapeCos + rotCenter.y + shapeOffset.y;
+
+			//=============================================================
+			// Draw main preview. Points less than a pixel from the last one are skipped (hundreds of sides
+			// would otherwise be hundreds of sub-pixel lines).
+			//=============================================================
+			if (ix == 0)
 			{
-#if SHOW_RAW_BUFFER                
-				nextPoint = rawBuffer[0];
-#else
-                nextPoint = rawPoint0;
-#endif
+				first = screenPoint;
+				last = screenPoint;
 			}
-			else
+			else if (std::abs(screenPoint.x - last.x) >= TS_POLYGEN_DRAW_MIN_SEGMENT_PX || std::abs(screenPoint.y - last.y) >= TS_POLYGEN_DRAW_MIN_SEGMENT_PX)
 			{
-				float p2Angle = static_cast<float>(v2) / n;
-				nextPoint.x = xAmpl * SINFUNC(p2Angle * 2 * PI + angleOffset_rad);
-				nextPoint.y = yAmpl * COSFUNC(p2Angle * 2 * PI + angleOffset_rad);
-				nextPointCalc = true;
+				drawLine(last.x, last.y, screenPoint.x, screenPoint.y, lineColor, raster, box);
+				last = screenPoint;
 			}
-			float midX = point.x + (nextPoint.x - point.x) * 0.5f;
-			float midY = point.y + (nextPoint.y - point.y) * 0.5f;
-			float ampl = SQRTFUNC(midX * midX + midY * midY) * innerRadiusMult;
-			innerAmpl.x = ampl * SGN(xAmpl);
-			innerAmpl.y = ampl * SGN(yAmpl);
-#endif
-			pAngle += innerAngleShift;
-			point.x = innerAmpl.x * SINFUNC(pAngle * 2 * PI + angleOffset_rad);
-			point.y = innerAmpl.y * COSFUNC(pAngle * 2 * PI + angleOffset_rad);
-			if (point.x < 0 && -point.x > maxVals.x)
-				maxVals.x = -point.x;
-			else if (point.x > maxVals.x)
-				maxVals.x = point.x;
-			if (point.y < 0 && -point.y > maxVals.y)
-				maxVals.y = -point.y;
-			else if (point.y > maxVals.y)
-				maxVals.y = point.y;
-
-#if SHOW_RAW_BUFFER
-			// Non-Rotated
-			rawBuffer[ix].x = point.x;
-			rawBuffer[ix].y = point.y;
-#endif
-
-			// Rotate
-			rotatedBuffer[ix].x = (point.x - rotCenter.x) * cosrot + (point.y - rotCenter.y) * sinrot + rotCenter.x;
-			rotatedBuffer[ix].y = (-point.x - rotCenter.y) * sinrot + (point.y - rotCenter.y) * cosrot + rotCenter.y;
-			ix++;
-		} // end if useInnerVerts
-	} // end loop through vertices
-
-
-	//=============================================================
-	// Draw main preview (Rotated and Translated)
-	//=============================================================
-	//float pad = padding - lineWidth;    
-    Vec offset = Vec(canvasCenterX + xOff, canvasCenterY + yOff);
-    drawShape(rotatedBuffer, numPoints, offset, /*mult*/ 1.0, lineWidth, lineColor);
-
-    //=============================================================
-	// Draw secondary small preview (pre-Rotation and translation)
-	//=============================================================
-#if SHOW_RAW_BUFFER
-	// float maxVal = (maxVals.x > maxVals.y) ? maxVals.x : maxVals.y;
-	// float smMult = 0.3f * canvasRadius / maxVal;
-	// offset.x = 0.85f * boxSize.x - padding; // Right
-	// offset.y = 0.85f * boxSize.y - padding; // Bottom	
-	// drawShape(args, rawBuffer, numPoints, offset, /*mult*/ smMult, lineWidth, secondColor);
-#endif
+		} // end loop through points
+		// Close the shape (back to the first point)
+		if (numPoints > 0)
+			drawLine(last.x, last.y, first.x, first.y, lineColor, raster, box);
+	} // end loop through shapes
+	if (pThis->previewMode == PREVIEW_PERSISTENCE)
+		rasterBlend(NT_screen, pThis->persistScreen, pThis->persistBox);
 
 	return pThis->topBarOn;
 }
 
+//=== * Presets (the morph snapshots aren't parameters, so they are saved here) * ===
+
+// Table as a flat array: [ x0, y0, x1, y1, ... ]
+void serialiseTable(_NT_jsonStream& stream, const char* name, const _polyGenVec* table, int numPoints)
+{
+    stream.addMemberName(name);
+    stream.openArray();
+    for (int i = 0; i < numPoints; i++)
+    {
+        stream.addNumber(table[i].x);
+        stream.addNumber(table[i].y);
+    }
+    stream.closeArray();
+    return;
+}
+
+bool deserialiseTable(_NT_jsonParse& parse, _polyGenVec* table, int& numPoints)
+{
+    int numElements;
+    if (!parse.numberOfArrayElements(numElements) || numElements > 2 * TS_POLYGEN_POINTS_MAX)
+        return false;
+    for (int i = 0; i < numElements; i++)
+    {
+        float value;
+        if (!parse.number(value))
+            return false;
+        if (i & 1)
+            table[i >> 1].y = value;
+        else
+            table[i >> 1].x = value;
+    }
+    numPoints = numElements / 2;
+    return true;
+}
+
+void serialise(_NT_algorithm* self, _NT_jsonStream& stream)
+{
+	_polyGenAlgorithm* pThis = (_polyGenAlgorithm*)self;
+    _polyGenEngine* engine = &(pThis->engine);
+    stream.addMemberName("snapshots");
+    stream.openArray();
+    for (int i = 0; i < TS_POLYGEN_SNAPSHOTS; i++)
+    {
+        const _polyGenSnapshot* snapshot = engine->snapshot(i);
+        int numPoints = (snapshot->stored) ? snapshot->numPoints : 0;
+        stream.openObject();
+        stream.addMemberName("stored");
+        stream.addBoolean(snapshot->stored);
+        stream.addMemberName("curves");
+        stream.addBoolean(snapshot->useCurves);
+        serialiseTable(stream, "points", snapshot->points, numPoints);
+        serialiseTable(stream, "lin", snapshot->lin, numPoints);
+        serialiseTable(stream, "quad", snapshot->quad, numPoints);
+        stream.closeObject();
+    }
+    stream.closeArray();
+    // Debug trace, only when asked for with Trace Export (and once it has stopped): the start of the buffer, up to
+    // TS_POLYGEN_TRACE_EXPORT_KB, as 32-bit words (every record is a multiple of 4 bytes). Saved once, so the presets
+    // saved after it don't carry it too. Not loaded back, polyGenReplay reads it straight from the preset file.
+    const _polyGenTraceHeader* header = reinterpret_cast<const _polyGenTraceHeader*>(pThis->traceBuffer);
+    if (pThis->traceExport && header != NULL && header->magic == TS_POLYGEN_TRACE_MAGIC && !pThis->traceCapture)
+    {
+        pThis->traceExport = false;
+        _polyGenTraceHeader saved = *header;
+        saved.length = traceExportLength(pThis->traceBuffer, header->length, TS_POLYGEN_TRACE_EXPORT_KB * 1024);
+        if (saved.length < header->length)
+            saved.flags |= TS_POLYGEN_TRACE_FLAG_CUT;
+        stream.addMemberName("trace");
+        stream.openArray();
+        for (uint32_t pos = 0; pos + sizeof(uint32_t) <= saved.length; pos += sizeof(uint32_t))
+        {
+            int32_t word;
+            memcpy(&word, (pos < sizeof(saved)) ? reinterpret_cast<const uint8_t*>(&saved) + pos : pThis->traceBuffer + pos, sizeof(word));
+            stream.addNumber(static_cast<int>(word));
+        }
+        stream.closeArray();
+    }
+    return;
+}
+
+bool deserialise(_NT_algorithm* self, _NT_jsonParse& parse)
+{
+	_polyGenAlgorithm* pThis = (_polyGenAlgorithm*)self;
+    _polyGenEngine* engine = &(pThis->engine);
+    int numMembers;
+    if (!parse.numberOfObjectMembers(numMembers))
+        return false;
+    for (int m = 0; m < numMembers; m++)
+    {
+        if (!parse.matchName("snapshots"))
+        {
+            if (!parse.skipMember())
+                return false;
+            continue;
+        }
+        int numSnapshots;
+        if (!parse.numberOfArrayElements(numSnapshots) || numSnapshots > TS_POLYGEN_SNAPSHOTS)
+            return false;
+        for (int i = 0; i < numSnapshots; i++)
+        {
+            // Parsed into the engine's staging copy, which step() (process()) takes over at the start of its next block
+            _polyGenSnapshot* snapshot = engine->stageSnapshot(i);
+            int numFields;
+            if (!parse.numberOfObjectMembers(numFields))
+                return false;
+            // Every table has to have the same # points, or it isn't used
+            int numPoints[3] = { 0, -1, -2 };
+            bool stored = false;
+            for (int f = 0; f < numFields; f++)
+            {
+                bool ok;
+                if (parse.matchName("stored"))
+                    ok = parse.boolean(stored);
+                else if (parse.matchName("curves"))
+                    ok = parse.boolean(snapshot->useCurves);
+                else if (parse.matchName("points"))
+                    ok = deserialiseTable(parse, snapshot->points, numPoints[0]);
+                else if (parse.matchName("lin"))
+                    ok = deserialiseTable(parse, snapshot->lin, numPoints[1]);
+                else if (parse.matchName("quad"))
+                    ok = deserialiseTable(parse, snapshot->quad, numPoints[2]);
+                else
+                    ok = parse.skipMember();
+                if (!ok)
+                    return false;
+            }
+            snapshot->stored = stored && numPoints[0] > 0 && numPoints[0] == numPoints[1] && numPoints[0] == numPoints[2];
+            snapshot->numPoints = (snapshot->stored) ? numPoints[0] : 0;
+            engine->loadSnapshot(i);
+        }
+    }
+    if (pThis->traceCapture)
+        traceSnapshots(pThis);
+    return true;
+}
+
 static const _NT_factory factory = 
 {
 	.guid = NT_MULTICHAR( 't', 'S', 'p', 'G' ),
 	.name = "polyGen",
 	.description = "Generates a polygon",
-    .numSpecifications = 0,
-    .specifications = NULL,
+    .numSpecifications = ARRAY_SIZE(specifications),
+    .specifications = specifications,
 	.calculateRequirements = calculateRequirements,
 	.construct = construct,
 	.parameterChanged = parameterChanged,
 	.step = step,
 	.draw = draw,
+	.serialise = serialise,
+	.deserialise = deserialise,
 };
 
 uintptr_t pluginEntry( _NT_selector selector, uint32_t data )
@@ -0,0 +1,2239 @@
+// polyGen DSP engine: the shapes, the clock, the renderers and the quality tiers, with no disting NT dependencies.
+// polyGen.cpp (the NT plugin) is a thin adapter over this, and the host tools run the same engine.
+// Everything here is static inline and every macro is TS_POLYGEN_ prefixed, so any number of translation units
+// (and hosts with their own clamp/Vec/PI) can include it.
+#ifndef POLYGEN_ENGINE_H
+#define POLYGEN_ENGINE_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TS_POLYGEN_PI             3.14159265
+#define TS_POLYGEN_PI_HALF     (TS_POLYGEN_PI/2.0)
+
+#define TS_POLYGEN_BASE_FREQ_HZ       261.6256f // f0 (base frequency) in Hz
+
+#define TS_POLYGEN_VERTICES_MIN        3    // Min # vertices/sides in polygon
+#define TS_POLYGEN_VERTICES_MAX       360     // Max #vertices/sides in polygon (was 36, near-circles & dense stars need more). Shape tables are in DRAM.
+#define TS_POLYGEN_VERTICES_DEF        3     // Default # vertices/sides in polygon
+#define TS_POLYGEN_ANGLE_OFFSET_DEG_MIN        -180    // Initial rotation/angle offset min
+#define TS_POLYGEN_ANGLE_OFFSET_DEG_MAX         180    // Initial rotation/angle offset max
+#define TS_POLYGEN_ANGLE_OFFSET_DEG_DEF           0    // Initial rotation/angle offset default
+
+#define TS_POLYGEN_POINTS_MAX   ((TS_POLYGEN_VERTICES_MAX*2))
+
+#define TS_POLYGEN_AMPL_MIN            -10.0f
+#define TS_POLYGEN_AMPL_MAX            10.0f
+#define TS_POLYGEN_AMPL_DEF            5.0f
+#define TS_POLYGEN_OUTPUT_V_MAX        10.0f   // X/Y outputs are clamped to +/- this (the module's output range)
+
+// Anti-Alias ========================
+#define TS_POLYGEN_AA_FADE_SAMPLES       1.0f   // Corner corrections fade in over this many samples past 1 sample per edge
+
+#define TS_POLGEN_ROT_DEG_MIN        -720.0f  // Rotation min (degrees). Why did we make 2 rotations? Don't remember now...
+#define TS_POLGEN_ROT_DEG_MAX         720.0f     // Rotation max (degrees)
+#define TS_POLGEN_ROT_DEG_DEF           0.0f  // Rotation def (degrees)
+
+// Inner Radius ======================
+#define TS_POLYGEN_INNER_RADIUS_MULT_MIN    -5.0f // -500%
+#define TS_POLYGEN_INNER_RADIUS_MULT_MAX     5.0f // +500%
+#define TS_POLYGEN_INNER_RADIUS_MULT_DEF     1.0f //  100%
+
+#define TS_POLYGEN_INNER_OFFSET_DEG_MIN     -5.0f
+#define TS_POLYGEN_INNER_OFFSET_DEG_MAX     5.0f
+#define TS_POLYGEN_INNER_OFFSET_DEG_DEF     0.0f
+
+// Geometry ==========================
+#define TS_POLYGEN_RECURRENCE_RESEED       32    // Rotation recurrence restarts from sinf/cosf every this many vertices (keeps float drift down)
+#define TS_POLYGEN_ALL_SHAPES_DIRTY      0x0F    // geometryDirty bit for every shape
+
+// Curvature =========================
+#define TS_POLYGEN_CURVATURE_MIN           -3.0f // -300% (bulge in)
+#define TS_POLYGEN_CURVATURE_MAX            3.0f // +300% (bulge out, 100% is close to a circle)
+#define TS_POLYGEN_CURVATURE_DEF            0.0f //    0% (straight edges)
+#define TS_POLYGEN_BUFF_SIZE            1024
+
+// Corner Trigger / Blanking Gate ====
+#define TS_POLYGEN_EVENTS_MAX             128    // Max # corner events in one block (more than this are dropped)
+#define TS_POLYGEN_TRIGGER_V             5.0f    // Corner trigger level (V)
+#define TS_POLYGEN_GATE_WIDTH_MS_MIN     0.1f    // Min trigger/blank width (ms)
+#define TS_POLYGEN_GATE_WIDTH_MS_MAX   100.0f    // Max trigger/blank width (ms)
+#define TS_POLYGEN_TRIGGER_WIDTH_MS_DEF  1.0f    // Default trigger width (ms)
+#define TS_POLYGEN_BLANK_WIDTH_MS_DEF    0.1f    // Default blank width (ms)
+#define TS_POLYGEN_BLANK_V_DEF           5.0f    // Default blanking level (V)
+
+// Multiple Shapes ===================
+#define TS_POLYGEN_SHAPES_MIN               1    // Min # shapes drawn (time-multiplexed) on the one X/Y pair
+#define TS_POLYGEN_SHAPES_MAX               4    // Max # shapes drawn (time-multiplexed) on the one X/Y pair
+#define TS_POLYGEN_SHAPES_DEF               1    // Default # shapes (just the main one)
+#define TS_POLYGEN_SHAPE_SCALE_MIN      -2.0f    // -200% (relative to the main X/Y amplitude)
+#define TS_POLYGEN_SHAPE_SCALE_MAX       2.0f    // +200%
+#define TS_POLYGEN_SHAPE_SCALE_DEF       0.5f    //   50%
+
+// Quality Tiers / CPU Governor ======
+#define TS_POLYGEN_CACHE_SIZE            4096    // # points in the cached cycle (power of 2, in DRAM, double buffered)
+#define TS_POLYGEN_CACHE_BUILD_CHUNK      128    // # cache points (re)built per block
+#define TS_POLYGEN_CACHE_RESOLVED        0x80    // Cache entry flag (with the EventType flags): point already has the main rotation/offset
+#define TS_POLYGEN_XFADE_SAMPLES          256    // Crossfade length going in/out of the cached tier
+#define TS_POLYGEN_XFADE_CHUNK             32    // Old tier is rendered in chunks of this many samples during the crossfade
+#define TS_POLYGEN_CPU_HZ        600000000.0f    // Core clock (for converting the cycle counter into load)
+#define TS_POLYGEN_CPU_BUDGET_MIN        1.0f    // CPU budget (% of the block time)
+#define TS_POLYGEN_CPU_BUDGET_MAX      100.0f
+#define TS_POLYGEN_CPU_BUDGET_DEF       10.0f
+#define TS_POLYGEN_GOVERNOR_SMOOTHING   0.05f    // Smoothing of the measured load (per block)
+#define TS_POLYGEN_GOVERNOR_UP_RATIO     0.5f    // Go back up a tier when the load is under this much of the budget
+#define TS_POLYGEN_GOVERNOR_HOLD_MS       500    // Min time between tier changes
+#define TS_POLYGEN_GOVERNOR_FALLBACK TIER_CONTROL_RATE  // Tier when there is no cycle count (counter not running, or on a host)
+
+// FM Input Modes ====================
+#define TS_POLYGEN_FM_DEPTH_MIN             0    // Linear/Through-Zero FM depth (Hz/V)
+#define TS_POLYGEN_FM_DEPTH_MAX          2000
+#define TS_POLYGEN_FM_DEPTH_DEF           100
+
+// Morph (A/B snapshots) =============
+#define TS_POLYGEN_SNAPSHOTS                2    // # stored snapshots (A & B)
+#define TS_POLYGEN_MORPH_CV_V           10.0f    // Morph input voltage for 100%
+#define TS_POLYGEN_MORPH_EPSILON      0.0001f    // Morph changes smaller than this don't re-blend the table
+
+// LFO Mode ==========================
+#define TS_POLYGEN_LFO_OCTAVES             10    // Frequency range drops this many octaves (8 Hz down to ~2 min a frame)
+#define TS_POLYGEN_LFO_SEGMENT             32    // Max # samples between shape evaluations (the outputs are ramped in between)
+
+#define TS_POLYGEN_SINFUNC(x)                    sinf(x)
+#define TS_POLYGEN_COSFUNC(x)                    cosf(x)
+
+#define TS_POLYGEN_SQRTFUNC(x)                   sqrtf(x)
+
+#define TS_POLYGEN_SGN(x)      ( (x < 0.0f) ? -1.0f : 1.0f )
+
+#define TS_POLYGEN_DEBUG        0
+
+#define TS_POLYGEN_IRADIUS_REL_2_MID_POINT        1 // Inner radius multiplier is multiplied by 0:Outer Amplitude, 1:Mid Point of line between corners
+#define TS_POLYGEN_MOD_ENABLED                    0 // Add modulation items. Currently we don't add these, we ran out of panel space and decided not needed since users can technically do this with the outputs in another module.
+                                                  // If turned back on, we have to add controls and such for these inputs/parameters.
+#define TS_POLYGEN_TRIGGER_SYNC_EARLY            0 // (1) Trigger sync 1 dt before next cycle or (0) wait until we are actually starting the next cycle.
+
+
+// #define TS_POLYGEN_FREQ_KNOB_MIN     0
+// #define TS_POLYGEN_FREQ_KNOB_MAX     32000
+// #define TS_POLYGEN_FREQ_KNOB_DEF     261
+
+#define TS_POLYGEN_FREQ_KNOB_MIN     -5
+#define TS_POLYGEN_FREQ_KNOB_MAX      5
+#define TS_POLYGEN_FREQ_KNOB_DEF      0
+
+#define TS_POLYGEN_FREQ_VOLTAGE_MIN     -5
+#define TS_POLYGEN_FREQ_VOLTAGE_MAX      5
+#define TS_POLYGEN_FREQ_VOLTAGE_DEF      0
+
+struct _polyGenVec {
+    float x;
+    float y;
+    _polyGenVec(){return;}
+    _polyGenVec(float _x, float _y){
+        this->x = _x;
+        this->y = _y;
+    }
+};
+
+static inline float polyGenClamp(float val, float min, float max){
+    if (val < min)
+        return min;
+    else if (val > max)
+        return max;
+    else
+        return val;
+}
+
+// 2^x for the exponential (V/Oct) clock: a handful of multiply-adds instead of a powf call, so it can run per sample.
+// The integer part goes straight into the float exponent and the fraction through a 5th order polynomial
+// (max error 1.6e-7, about 0.0003 cents). Good for -126 <= x < 128.
+static inline float polyGenExp2(float x){
+    int i = static_cast<int>(x);
+    if (x < i)
+        i--; // floor
+    float f = x - i;
+    float p = 9.999999404e-01f + f * (6.931529641e-01f + f * (2.401545346e-01f + f * (5.582360551e-02f + f * (8.992584422e-03f + f * 1.876232913e-03f))));
+    uint32_t bits = static_cast<uint32_t>(i + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// One (pre-computed) shape for the multi-shape scheduler. Shape 0 is the main shape.
+struct _polyGenShape
+{
+    // Number of sides/vertices
+    uint16_t numVertices = TS_POLYGEN_VERTICES_DEF;
+    // Size relative to the main X/Y amplitude (shape 0 is always 1)
+    float scale = 1.0f;
+    // Offset (applied before the main rotation/offset)
+    float xOffset = 0.0f;
+    float yOffset = 0.0f;
+    // Rotation of this shape about its own center
+    float rotation_rad = 0.0f;
+    // # points in the table: numVertices, or 2*numVertices with inner/2ndary vertices
+    int numPoints = 0;
+    // Multiplier of the base frequency for the main clock (# sides / share of the frame)
+    float dtMult = TS_POLYGEN_VERTICES_DEF;
+    // Where this shape starts in the whole frame (0 to 1) and how much of it this shape gets
+    float start = 0.0f;
+    float share = 1.0f;
+    // Table has inner/2ndary vertices (points alternate outer, inner) and curved edges
+    bool useInnerVerts = false;
+    bool useCurves = false;
+    // Main rotation & offset are already in the table (morph)
+    bool resolved = false;
+    // Fewest table edges from one corner to the next (anti-aliasing needs a sample per corner, not per table edge)
+    float cornerSpacing = 1.0f;
+    // Tables (TS_POLYGEN_POINTS_MAX each, in DRAM):
+    // Points in drawing order (outer corner, [inner vertex], next outer corner, ...) before the main rotation/offset
+    _polyGenVec* points = NULL;
+    // Edge from points[i] to points[i+1] as a quadratic Bezier: P(t) = points[i] + lin[i]*t + quad[i]*t^2
+    // (straight edges have quad[i] = 0 and lin[i] = points[i+1] - points[i])
+    _polyGenVec* lin = NULL;
+    _polyGenVec* quad = NULL;
+    // Point i is a real corner (NULL: every point is). Only the morph has points that aren't, where a stored
+    // edge is split up to line up with the other snapshot. They get no gates and no corner anti-aliasing.
+    uint8_t* corners = NULL;
+};
+
+// Stored copy of the main shape's resolved geometry (after amplitude, inner radius, curvature and the main
+// rotation/offset), one end of the morph.
+struct _polyGenSnapshot
+{
+    bool stored = false;
+    bool useCurves = false;
+    int numPoints = 0;
+    // Tables (TS_POLYGEN_POINTS_MAX each, in DRAM): as stored (same layout as the shape tables)
+    _polyGenVec* points = NULL;
+    _polyGenVec* lin = NULL;
+    _polyGenVec* quad = NULL;
+    // Tables (TS_POLYGEN_POINTS_MAX each, in DRAM): resampled to the morph's # points (B holds B - A, ready for the blend)
+    _polyGenVec* morphPoints = NULL;
+    _polyGenVec* morphLin = NULL;
+    _polyGenVec* morphQuad = NULL;
+    // Morph point i is (or stands in for) one of the stored points
+    uint8_t* morphCorners = NULL;
+};
+
+// Corner event flags (for the gate outputs)
+enum EventType : uint8_t
+{
+    // Passed a corner (outer or inner/2ndary vertex)
+    EVENT_CORNER = 0x01,
+    // Jumped to the next shape (the beam retraces)
+    EVENT_RETRACE = 0x02
+};
+
+// Quality parameter values
+enum QualityMode : uint8_t
+{
+    // Pick the tier from the measured CPU load
+    QUALITY_AUTO,
+    QUALITY_FULL,
+    QUALITY_CONTROL_RATE,
+    QUALITY_CACHED
+};
+
+// Quality tiers, best (most expensive) first
+enum QualityTier : uint8_t
+{
+    // Everything per sample
+    TIER_FULL,
+    // Clock & spin per block (interpolated), shapes still per sample
+    TIER_CONTROL_RATE,
+    // Play back a cached cycle of the whole frame
+    TIER_CACHED
+};
+
+// FM Mode parameter values
+enum FMMode : uint8_t
+{
+    // 1V/Octave, added to the Frequency knob
+    FM_EXPONENTIAL,
+    // Hz/V added to the knob's frequency (stops at 0 Hz)
+    FM_LINEAR,
+    // Hz/V added to the knob's frequency, below 0 Hz the shape is drawn backwards
+    FM_THROUGH_ZERO
+};
+
+// All of the state the audio needs. The render functions below work on it; _polyGenEngine keeps it private.
+struct _polyGenEngineState
+{
+    //=== * Sample Rate (prepare()) * ===
+    float sampleRate = 48000.0f;
+    float invSampleRate = 1.0f / 48000.0f;
+    float clockScale = 1.0f / 48000.0f;  // Clock (frames per sample) per Hz: 1/sample rate, TS_POLYGEN_LFO_OCTAVES lower in LFO mode
+    float cpuCyclesPerSample = TS_POLYGEN_CPU_HZ / 48000.0f;
+    int governorHoldSamples = TS_POLYGEN_GOVERNOR_HOLD_MS * 48;
+
+    // Phase
+    float phase = 0.0f;
+    // Current Vertex
+    int currVertexIx = 0;
+    // Next Vertex
+    int nextVertexIx = 1;
+    // Main shape, number of sides/vertices
+    uint16_t numVertices = TS_POLYGEN_VERTICES_DEF;
+    float angleOffset_rad = 0.0f;
+    float xAmpl = TS_POLYGEN_AMPL_DEF;
+    float yAmpl = TS_POLYGEN_AMPL_DEF;
+    float xOffset = 0.0f;
+    float yOffset = 0.0f;
+    // Pre offset (center of rotation) X
+    float xCRot = 0.0f;
+    // Pre offset (center of rotation) Y
+    float yCRot = 0.0f;
+    // Rotation
+    bool rotationIsAbs = true;
+    float rotation_rad = 0.0f;
+    float rotation_deg = 0.0f;
+    float rotationKnob_deg = 0.0f;   // Rotation (degrees), or spin (degrees/s) when spinning
+    float spinPerSample_deg = 0.0f;  // Spin per sample (prepare())
+    int lastRotationAbs = -1;
+
+    // Frequency 
+    float frequencyParam_V = 0.0f;
+    uint8_t fmMode = 0;              // FMMode of the frequency input
+    float fmDepth_HzPerV = TS_POLYGEN_FM_DEPTH_DEF;  // Linear/Through-Zero FM depth
+    
+    //=== * Inner Vertices * ===
+    float innerRadiusMult = TS_POLYGEN_INNER_RADIUS_MULT_DEF;     // Multiplier for radius (relative to main shape)
+    float innerAngleMult = TS_POLYGEN_INNER_OFFSET_DEG_DEF;     // Multiplier for angle (relative to the mid-angle of main shape)
+    float innerPhase = 0.0f;         // Inner/2ndary phase.
+    int innerSideIx = 0;            // Which side we are on (from inner/2ndary point). Either 0 (before inner vertex) or 1 (after inner vertex).
+    bool useInnerVerts = false;
+
+    //=== * Curved Edges * ===
+    float curvature = TS_POLYGEN_CURVATURE_DEF; // 0 is straight, 1 is roughly a circle, > 1 or < 0 for flowers
+    bool useCurves = false;
+
+    //=== * Anti-Aliasing * ===
+    bool antiAlias = false;          // Band-limit the corners (polyBLAMP/polyBLEP on corner events only)
+    int aaShapeIx = -1;              // Shape we were on last sample. -1 if unknown.
+    int aaEdgeIx = -1;               // Edge we were on last sample
+    bool aaSaturated = false;        // First half of an inner edge already reached its end (t clamped at 1)
+
+    //=== * Corner Trigger / Blanking Gate * ===
+    // Corner events for this block (recorded during the phase advance, then the gates are rendered from them)
+    uint16_t eventFrames[TS_POLYGEN_EVENTS_MAX];
+    uint8_t eventTypes[TS_POLYGEN_EVENTS_MAX];  // EventType flags
+    int numEvents = 0;
+    float triggerWidth_ms = TS_POLYGEN_TRIGGER_WIDTH_MS_DEF;
+    float blankWidth_ms = TS_POLYGEN_BLANK_WIDTH_MS_DEF;
+    int triggerWidth = 0;            // Samples (prepare())
+    int blankWidth = 0;              // Samples (prepare())
+    uint8_t blankMask = 1;           // Which events blank the beam (EventType flags)
+    float blankLevel = TS_POLYGEN_BLANK_V_DEF;
+    int triggerRemaining = 0;        // Samples left high (carried to the next block)
+    int blankRemaining = 0;          // Samples left high (carried to the next block)
+
+    //=== * Multiple Shapes * ===
+    _polyGenShape shapes[TS_POLYGEN_SHAPES_MAX];
+    uint8_t numShapes = TS_POLYGEN_SHAPES_DEF;
+    bool shareBySides = false;       // Share of the frame each shape gets: equal (false) or by # of sides (true)
+    int currShapeIx = 0;             // Which shape we are currently drawing
+    uint8_t geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;  // Shape tables that need to be rebuilt (bit per shape)
+    bool recordEvents = false;       // Corner events are needed this block (a gate output is routed)
+
+    //=== * Quality Tiers * ===
+    uint8_t qualityMode = 1;         // QualityMode (Full by default)
+    uint8_t tier = 0;                // QualityTier we are rendering with
+    uint8_t autoTier = 0;            // QualityTier the governor wants (Auto)
+    float cpuBudget = TS_POLYGEN_CPU_BUDGET_DEF / 100.0f;  // Fraction of the block time
+    float cpuLoad = 0.0f;            // Measured (smoothed) fraction of the block time
+    int governorHold = 0;            // Samples until the governor may change tier again
+    // Cached cycle of the whole frame (all shapes, before the main rotation/offset). In DRAM, double buffered.
+    _polyGenVec* cachePoints[2] = { NULL, NULL };
+    uint8_t* cacheEvents[2] = { NULL, NULL };  // EventType flags between entry i and i+1 (and TS_POLYGEN_CACHE_RESOLVED)
+    int cacheFront = 0;              // Buffer being played
+    int cacheBuildIx = TS_POLYGEN_CACHE_SIZE;  // Next point to build in the back buffer
+    bool cacheDirty = true;          // Geometry changed, rebuild
+    bool cacheValid = false;         // Front buffer has a whole cycle
+    float cachePhase = 0.0f;         // Where we are in the frame (0 to 1)
+    int cacheIx = 0;                 // Cache entry for the last sample
+    // Crossfade going in/out of the cached tier
+    uint8_t xfadeFromTier = 0;
+    int xfadeRemaining = 0;
+    float xfadeX[TS_POLYGEN_XFADE_CHUNK];
+    float xfadeY[TS_POLYGEN_XFADE_CHUNK];
+
+    //=== * Morph (A/B snapshots) * ===
+    _polyGenSnapshot snapshots[TS_POLYGEN_SNAPSHOTS];
+    _polyGenShape morphShape;        // Blend of the snapshots, drawn instead of the main shape while morphing
+    bool morphOn = false;
+    bool morphActive = false;        // Morph is on and both snapshots are stored
+    bool morphResample = true;       // Snapshots changed, resample them to a common # points
+    float morphAmount = 0.0f;        // Morph knob (0 is A, 1 is B)
+    float morph = -1.0f;             // Blend in the morph table (-1 to re-blend)
+    uint8_t pendingStore = 0;        // Snapshots to store at the next process() (bit per snapshot)
+    _polyGenSnapshot stagedSnapshots[TS_POLYGEN_SNAPSHOTS];  // Loaded (preset/replay), not in use yet
+    uint8_t pendingLoad = 0;         // Staged snapshots to take over at the next process() (bit per snapshot)
+    float morphCV = 0.0f;            // Morph input (V) for this block
+
+    //=== * LFO Mode * ===
+    bool lfoMode = false;            // Low frequency range, shape worked out per segment and ramped in between
+    bool lfoActive = false;          // Rendering in LFO mode (switches over at the start of a block)
+    float lfoPhase = 0.0f;           // Where we are in the whole frame (0 to 1)
+    _polyGenVec lfoPoint;                    // Output at the end of the last segment (the next ramp starts here)
+    float lfoClockIn = NAN;          // Input the clock below is for (NAN when the frequency settings change)
+    float lfoClock = 0.0f;           // Clock (frames per sample), so it is only worked out again when the input moves
+    float lfoRotation_rad = 0.0f;    // Rotation the sin/cos below are for
+    float lfoSin = 0.0f;
+    float lfoCos = 1.0f;
+};
+
+// The polyGen DSP engine: typed setters, a batch process() and a few readouts, around a private _polyGenEngineState.
+// Nothing in here knows about the disting NT (parameters, busses, NT_globals), so host tools can run the
+// same engine as the plugin. setMemory() and prepare() before the first process(); it never allocates.
+class _polyGenEngine : private _polyGenEngineState
+{
+public:
+    // Memory for the shape, snapshot & morph tables and the cached cycle (bytes), and where it is
+    static uint32_t memorySize();
+    void setMemory(uint8_t* memory);
+    // Sample rate, and everything derived from it
+    void prepare(float sampleRate);
+    // Render a block: voct is the frequency input (V/Oct, or V for Linear/Through-Zero FM)
+    void process(const float* voct, float* x, float* y, int numFrames);
+    // Trigger & blanking gates for the corners in the last process() (either can be NULL)
+    void renderGates(float* trigger, float* blank, int numFrames);
+
+    void setFrequency(float volts);
+    void setFMMode(uint8_t fmMode);
+    void setFMDepth(float hzPerV);
+    void setNumVertices(int numVertices);
+    void setAngleOffset(float degrees);
+    void setInnerRadius(float mult);
+    void setInnerAngle(float mult);
+    void setCurvature(float curvature);
+    void setAmplitude(float x, float y);
+    void setOffset(float x, float y);
+    void setRotationCenter(float x, float y);
+    void setRotation(float degrees);
+    void setSpin(bool spin);
+    void setAntiAlias(bool antiAlias);
+    void setNumShapes(int numShapes);
+    void setShapeShare(bool bySides);
+    void setShapeSides(int shapeIx, int numVertices);
+    void setShapeScale(int shapeIx, float scale);
+    void setShapeOffset(int shapeIx, float x, float y);
+    void setShapeRotation(int shapeIx, float degrees);
+    void setEventsEnabled(bool enabled);
+    void setTriggerWidth(float ms);
+    void setBlank(uint8_t mask, float ms, float level);
+    void setQuality(uint8_t qualityMode);
+    void setCpuBudget(float fraction);
+    void setMorph(bool on);
+    void setMorphAmount(float amount);
+    void setMorphCV(float volts);
+    void setLFO(bool on);
+    void requestSnapshot(int snapshotIx);
+    // Loading a snapshot (from the UI): fill in the one stageSnapshot() returns (stored, useCurves, numPoints and
+    // the points/lin/quad tables), then loadSnapshot() and it replaces the stored one at the next process().
+    _polyGenSnapshot* stageSnapshot(int snapshotIx);
+    void loadSnapshot(int snapshotIx);
+    // Snapshot as the next process() will have it (the staged one while a load is pending), and whether it will be stored then
+    const _polyGenSnapshot* snapshot(int snapshotIx) const;
+    bool isStorePending(int snapshotIx) const;
+
+    // Back to the state a new engine starts in (everything the setters don't set)
+    void reset();
+    // Auto quality: the cycles the last block took (0 if they couldn't be measured), and the tier the governor picked
+    void updateGovernor(uint32_t cycles, int numFrames);
+    uint8_t getAutoTier() const;
+    void setAutoTier(uint8_t tier);
+    float getSampleRate() const;
+
+    // For the preview: shape as drawn (the morph in place of the main shape), and the main rotation (radians) & offsets
+    int getNumShapes() const;
+    const _polyGenShape* getDrawnShape(int shapeIx) const;
+    float getRotation() const;
+    _polyGenVec getRotationCenter() const;
+    _polyGenVec getOffset() const;
+};
+
+// Shape as it is drawn: while morphing, the morph table stands in for the main shape.
+static inline _polyGenShape* getShape(_polyGenEngineState* pThis, int shapeIx)
+{
+    return (shapeIx == 0 && pThis->morphActive) ? &(pThis->morphShape) : &(pThis->shapes[shapeIx]);
+}
+static inline const _polyGenShape* getShape(const _polyGenEngineState* pThis, int shapeIx)
+{
+    return (shapeIx == 0 && pThis->morphActive) ? &(pThis->morphShape) : &(pThis->shapes[shapeIx]);
+}
+
+// Gets the frequency from the voltage (1V per octave)
+static inline float getFrequencyFromVoltage(float voltage){
+    // 1V per Octave
+    return TS_POLYGEN_BASE_FREQ_HZ*polyGenExp2(voltage);
+}
+
+// Reset everything that isn't set from the parameters to what a new engine starts with, so a replay (on a new
+// engine) starts from the same state. Settings whose setters depend on each other (Spin and Rotation) go back to
+// their defaults too, so setting them again in the same order gives the same result.
+static inline void resetState(_polyGenEngineState* pThis)
+{
+    pThis->phase = 0.0f;
+    pThis->currVertexIx = 0;
+    pThis->nextVertexIx = 1;
+    pThis->rotationIsAbs = true;
+    pThis->rotationKnob_deg = 0.0f;
+    pThis->spinPerSample_deg = 0.0f;
+    pThis->lastRotationAbs = -1;
+    pThis->rotation_deg = 0.0f;
+    pThis->rotation_rad = 0.0f;
+    pThis->innerPhase = 0.0f;
+    pThis->innerSideIx = 0;
+    pThis->aaShapeIx = -1;
+    pThis->aaEdgeIx = -1;
+    pThis->aaSaturated = false;
+    pThis->numEvents = 0;
+    pThis->triggerRemaining = 0;
+    pThis->blankRemaining = 0;
+    pThis->currShapeIx = 0;
+    pThis->geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    pThis->tier = TIER_FULL;
+    pThis->autoTier = TIER_FULL;
+    pThis->cpuLoad = 0.0f;
+    pThis->governorHold = 0;
+    pThis->cacheFront = 0;
+    pThis->cacheBuildIx = TS_POLYGEN_CACHE_SIZE;
+    pThis->cacheDirty = true;
+    pThis->cacheValid = false;
+    pThis->cachePhase = 0.0f;
+    pThis->cacheIx = 0;
+    pThis->xfadeFromTier = 0;
+    pThis->xfadeRemaining = 0;
+    pThis->morphActive = false;
+    pThis->morphResample = true;
+    pThis->morph = -1.0f;
+    pThis->morphCV = 0.0f;
+    pThis->lfoActive = false;
+    pThis->lfoPhase = 0.0f;
+    pThis->lfoPoint = _polyGenVec(0.0f, 0.0f);
+    pThis->lfoClock = 0.0f;
+    pThis->lfoClockIn = NAN;
+    pThis->lfoRotation_rad = 0.0f;
+    pThis->lfoSin = 0.0f;
+    pThis->lfoCos = 1.0f;
+    return;
+}
+
+// Build the point table for one shape: outer corners, with the inner/2ndary vertex after each corner (if used).
+// The shape's own scale, rotation & offset are baked in, the main rotation & offset are applied in process().
+static inline void buildShapeGeometry(_polyGenEngineState* pThis, int shapeIx)
+{
+    _polyGenShape* shape = &(pThis->shapes[shapeIx]);
+    if (shapeIx == 0)
+        shape->numVertices = pThis->numVertices; // Main shape uses the main parameters
+    int numVertices = shape->numVertices;
+    int stride = (pThis->useInnerVerts) ? 2 : 1;
+    float xAmpl = pThis->xAmpl * shape->scale;
+    float yAmpl = pThis->yAmpl * shape->scale;
+    _polyGenVec* points = shape->points;
+
+    // Each vertex is the last one rotated by 2*TS_POLYGEN_PI/N (rotation recurrence), so hundreds of sides don't cost hundreds of sinf/cosf.
+    float stepSin = TS_POLYGEN_SINFUNC( 2 * TS_POLYGEN_PI / numVertices );
+    float stepCos = TS_POLYGEN_COSFUNC( 2 * TS_POLYGEN_PI / numVertices );
+    float sinA = 0.0f, cosA = 1.0f;
+
+    //---------------------
+    // Outer Corners
+    //---------------------
+    for (int v = 0; v < numVertices; v++)
+    {
+        if (v % TS_POLYGEN_RECURRENCE_RESEED == 0)
+        {
+            float vTime = static_cast<float>(v) / static_cast<float>(numVertices);
+            sinA = TS_POLYGEN_SINFUNC( 2 * TS_POLYGEN_PI * vTime + pThis->angleOffset_rad);
+            cosA = TS_POLYGEN_COSFUNC( 2 * TS_POLYGEN_PI * vTime + pThis->angleOffset_rad);
+        }
+        points[v * stride].x = xAmpl * sinA;
+        points[v * stride].y = yAmpl * cosA;
+        float nextSin = sinA * stepCos + cosA * stepSin;
+        cosA = cosA * stepCos - sinA * stepSin;
+        sinA = nextSin;
+    }
+    //---------------------
+    // Inner/2ndary Vertices
+    //---------------------
+    if (pThis->useInnerVerts)
+    {
+        float iTime = 0.5f * (1 + pThis->innerAngleMult);
+        for (int v = 0; v < numVertices; v++)
+        {
+            _polyGenVec thisCorner = points[v * stride];
+            _polyGenVec nextCorner = points[((v + 1 < numVertices) ? v + 1 : 0) * stride];
+            _polyGenVec iAmpl = _polyGenVec(xAmpl, yAmpl);
+#if TS_POLYGEN_IRADIUS_REL_2_MID_POINT
+            // Calculate the point on the line between the two corners
+            float midX = thisCorner.x + (nextCorner.x - thisCorner.x) * 0.5f;
+            float midY = thisCorner.y + (nextCorner.y - thisCorner.y) * 0.5f;
+            float ampl = TS_POLYGEN_SQRTFUNC(midX * midX + midY * midY) * pThis->innerRadiusMult;
+            iAmpl.x = ampl * TS_POLYGEN_SGN(iAmpl.x);
+            iAmpl.y = ampl * TS_POLYGEN_SGN(iAmpl.y);
+#else
+            iAmpl.x *= pThis->innerRadiusMult;
+            iAmpl.y *= pThis->innerRadiusMult;
+#endif
+            if (v % TS_POLYGEN_RECURRENCE_RESEED == 0)
+            {
+                float vTime = static_cast<float>(v) / static_cast<float>(numVertices) + iTime / numVertices;
+                sinA = TS_POLYGEN_SINFUNC( 2 * TS_POLYGEN_PI * vTime + pThis->angleOffset_rad);
+                cosA = TS_POLYGEN_COSFUNC( 2 * TS_POLYGEN_PI * vTime + pThis->angleOffset_rad);
+            }
+            points[v * stride + 1].x = iAmpl.x * sinA;
+            points[v * stride + 1].y = iAmpl.y * cosA;
+            float nextSin = sinA * stepCos + cosA * stepSin;
+            cosA = cosA * stepCos - sinA * stepSin;
+            sinA = nextSin;
+        }
+    }
+    shape->numPoints = numVertices * stride;
+    shape->useInnerVerts = pThis->useInnerVerts;
+    shape->useCurves = pThis->useCurves;
+    shape->resolved = false;
+
+    //---------------------
+    // Edges (straight or quadratic Bezier)
+    //---------------------
+    for (int i = 0; i < shape->numPoints; i++)
+    {
+        _polyGenVec p0 = points[i];
+        _polyGenVec p1 = points[(i + 1 < shape->numPoints) ? i + 1 : 0];
+        if (pThis->useCurves)
+        {
+            // Control point: the mid point of the edge pushed out (or in) from the center.
+            // At 100% the curve's mid point is on the circle through the two end points (so a polygon -> circle).
+            _polyGenVec mid = _polyGenVec(0.5f * (p0.x + p1.x), 0.5f * (p0.y + p1.y));
+            float midR = TS_POLYGEN_SQRTFUNC(mid.x * mid.x + mid.y * mid.y);
+            float r = TS_POLYGEN_SQRTFUNC(0.5f * (p0.x * p0.x + p0.y * p0.y + p1.x * p1.x + p1.y * p1.y));
+            _polyGenVec ctrl = mid;
+            if (midR > 0.0001f)
+            {
+                float k = 1.0f + pThis->curvature * 2.0f * (r / midR - 1.0f);
+                ctrl.x = mid.x * k;
+                ctrl.y = mid.y * k;
+            }
+            shape->lin[i].x = 2.0f * (ctrl.x - p0.x);
+            shape->lin[i].y = 2.0f * (ctrl.y - p0.y);
+            shape->quad[i].x = p0.x - 2.0f * ctrl.x + p1.x;
+            shape->quad[i].y = p0.y - 2.0f * ctrl.y + p1.y;
+        }
+        else
+        {
+            shape->lin[i].x = p1.x - p0.x;
+            shape->lin[i].y = p1.y - p0.y;
+            shape->quad[i].x = 0.0f;
+            shape->quad[i].y = 0.0f;
+        }
+    }
+
+    //---------------------
+    // Shape's own rotation & offset
+    //---------------------
+    if (shapeIx > 0)
+    {
+        float sinrot = TS_POLYGEN_SINFUNC( shape->rotation_rad );
+        float cosrot = TS_POLYGEN_COSFUNC( shape->rotation_rad );
+        for (int i = 0; i < shape->numPoints; i++)
+        {
+            float x = points[i].x;
+            float y = points[i].y;
+            points[i].x = x * cosrot - y * sinrot + shape->xOffset;
+            points[i].y = x * sinrot + y * cosrot + shape->yOffset;
+            // Edge coefficients are just directions (no offset)
+            x = shape->lin[i].x;
+            y = shape->lin[i].y;
+            shape->lin[i].x = x * cosrot - y * sinrot;
+            shape->lin[i].y = x * sinrot + y * cosrot;
+            x = shape->quad[i].x;
+            y = shape->quad[i].y;
+            shape->quad[i].x = x * cosrot - y * sinrot;
+            shape->quad[i].y = x * sinrot + y * cosrot;
+        }
+    }
+    return;
+}
+
+// Rebuild the changed shape tables and the scheduler's share of the frame for each shape.
+// Only done when the geometry changes, so switching shapes in process() is just an index change.
+static inline void rebuildGeometry(_polyGenEngineState* pThis)
+{
+    float totalWeight = 0.0f;
+    for (int i = 0; i < pThis->numShapes; i++)
+    {
+        if (pThis->geometryDirty & (1 << i))
+            buildShapeGeometry(pThis, i);
+        totalWeight += (pThis->shareBySides) ? static_cast<float>(pThis->shapes[i].numVertices) : 1.0f;
+    }
+    for (int i = 0; i < pThis->numShapes; i++)
+    {
+        // Each shape gets a share of the frame, so the whole frame is still drawn at the main frequency
+        // no matter how many shapes there are.
+        _polyGenShape* shape = &(pThis->shapes[i]);
+        float share = ((pThis->shareBySides) ? static_cast<float>(shape->numVertices) : 1.0f) / totalWeight;
+        shape->dtMult = static_cast<float>(shape->numVertices) / share;
+        shape->start = (i > 0) ? pThis->shapes[i - 1].start + pThis->shapes[i - 1].share : 0.0f;
+        shape->share = share;
+    }
+    if (pThis->currShapeIx >= pThis->numShapes)
+        pThis->currShapeIx = 0;
+    pThis->aaShapeIx = -1; // Edges have changed
+    pThis->cacheDirty = true;
+    pThis->geometryDirty &= ~((1 << pThis->numShapes) - 1); // Shapes not in use are built when they are turned on
+    return;
+}
+
+//=== * Morph (A/B snapshots) * ===
+
+// Store the main shape as it is now into a snapshot. The main rotation/offset are baked in, so the snapshot
+// is the resolved geometry and morphing never has to go back to the parameters.
+static inline void storeSnapshot(_polyGenEngineState* pThis, int snapshotIx)
+{
+    const _polyGenShape* shape = &(pThis->shapes[0]);
+    _polyGenSnapshot* snapshot = &(pThis->snapshots[snapshotIx]);
+    if (shape->numPoints == 0)
+        return; // Not built yet
+    float sinrot = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+    float cosrot = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+    for (int i = 0; i < shape->numPoints; i++)
+    {
+        float x = shape->points[i].x - pThis->xCRot;
+        float y = shape->points[i].y - pThis->yCRot;
+        snapshot->points[i].x = x * cosrot - y * sinrot + pThis->xCRot + pThis->xOffset;
+        snapshot->points[i].y = x * sinrot + y * cosrot + pThis->yCRot + pThis->yOffset;
+        snapshot->lin[i].x = shape->lin[i].x * cosrot - shape->lin[i].y * sinrot;
+        snapshot->lin[i].y = shape->lin[i].x * sinrot + shape->lin[i].y * cosrot;
+        snapshot->quad[i].x = shape->quad[i].x * cosrot - shape->quad[i].y * sinrot;
+        snapshot->quad[i].y = shape->quad[i].x * sinrot + shape->quad[i].y * cosrot;
+    }
+    snapshot->numPoints = shape->numPoints;
+    snapshot->useCurves = shape->useCurves;
+    snapshot->stored = true;
+    pThis->morphResample = true;
+    return;
+}
+
+// Point on a snapshot's edge (as stored).
+static inline _polyGenVec snapshotPoint(const _polyGenSnapshot* snapshot, int edgeIx, float t)
+{
+    _polyGenVec point = snapshot->points[edgeIx];
+    point.x += (snapshot->lin[edgeIx].x + snapshot->quad[edgeIx].x * t) * t;
+    point.y += (snapshot->lin[edgeIx].y + snapshot->quad[edgeIx].y * t) * t;
+    return point;
+}
+
+// Resample a snapshot to numPoints edges (so both ends of the morph line up point for point).
+// Morph edges inside one stored edge are the exact piece of its curve, ones across a corner are straight.
+static inline void resampleSnapshot(_polyGenSnapshot* snapshot, int numPoints)
+{
+    float dt = static_cast<float>(snapshot->numPoints) / numPoints; // Stored edges per morph edge
+    for (int j = 0; j < numPoints; j++)
+    {
+        // Start & end of this morph edge, in 1/numPoints of a stored edge
+        int startPos = j * snapshot->numPoints;
+        int endPos = startPos + snapshot->numPoints;
+        int edgeIx = startPos / numPoints;
+        float t0 = static_cast<float>(startPos - edgeIx * numPoints) / numPoints;
+        const _polyGenVec& lin = snapshot->lin[edgeIx];
+        const _polyGenVec& quad = snapshot->quad[edgeIx];
+        _polyGenVec point = snapshotPoint(snapshot, edgeIx, t0);
+        snapshot->morphPoints[j] = point;
+        // Starts on a stored point, or crosses one (when there are too many points to keep them all)
+        snapshot->morphCorners[j] = (startPos == edgeIx * numPoints || (endPos - 1) / numPoints != edgeIx) ? 1 : 0;
+        if (endPos <= (edgeIx + 1) * numPoints)
+        {
+            // P(t0 + dt*s) = P(t0) + (lin + 2*quad*t0)*dt*s + quad*dt^2*s^2
+            snapshot->morphLin[j] = _polyGenVec((lin.x + 2.0f * quad.x * t0) * dt, (lin.y + 2.0f * quad.y * t0) * dt);
+            snapshot->morphQuad[j] = _polyGenVec(quad.x * dt * dt, quad.y * dt * dt);
+        }
+        else
+        {
+            int endIx = endPos / numPoints;
+            float t1 = static_cast<float>(endPos - endIx * numPoints) / numPoints;
+            _polyGenVec end = snapshotPoint(snapshot, endIx % snapshot->numPoints, t1);
+            snapshot->morphLin[j] = _polyGenVec(end.x - point.x, end.y - point.y);
+            snapshot->morphQuad[j] = _polyGenVec(0.0f, 0.0f);
+        }
+    }
+    return;
+}
+
+// Resample both snapshots to a common # points: the least common multiple of theirs (every stored corner
+// is kept) or as many as the tables hold.
+static inline void resampleSnapshots(_polyGenEngineState* pThis)
+{
+    _polyGenSnapshot* a = &(pThis->snapshots[0]);
+    _polyGenSnapshot* b = &(pThis->snapshots[1]);
+    int gcd = a->numPoints, r = b->numPoints;
+    while (r != 0)
+    {
+        int t = gcd % r;
+        gcd = r;
+        r = t;
+    }
+    int numPoints = a->numPoints / gcd * b->numPoints;
+    if (numPoints > TS_POLYGEN_POINTS_MAX)
+        numPoints = TS_POLYGEN_POINTS_MAX;
+    resampleSnapshot(a, numPoints);
+    resampleSnapshot(b, numPoints);
+    for (int i = 0; i < numPoints; i++)
+    {
+        b->morphPoints[i] = _polyGenVec(b->morphPoints[i].x - a->morphPoints[i].x, b->morphPoints[i].y - a->morphPoints[i].y);
+        b->morphLin[i] = _polyGenVec(b->morphLin[i].x - a->morphLin[i].x, b->morphLin[i].y - a->morphLin[i].y);
+        b->morphQuad[i] = _polyGenVec(b->morphQuad[i].x - a->morphQuad[i].x, b->morphQuad[i].y - a->morphQuad[i].y);
+    }
+    _polyGenShape* shape = &(pThis->morphShape);
+    shape->numVertices = static_cast<uint16_t>(numPoints);
+    shape->numPoints = numPoints;
+    shape->useCurves = pThis->snapshots[0].useCurves || pThis->snapshots[1].useCurves;
+    pThis->morphResample = false;
+    pThis->morph = -1.0f;
+    return;
+}
+
+// Once per block: take over any loaded snapshots, store any asked for, then blend the morph table if the morph moved.
+// The per-sample cost is then the same as for a static shape (it is just another shape table).
+static inline void updateMorph(_polyGenEngineState* pThis)
+{
+    // The UI sets these bits, so take them (and clear them) in one go
+    uint8_t load = __atomic_exchange_n(&(pThis->pendingLoad), 0, __ATOMIC_ACQUIRE);
+    uint8_t store = __atomic_exchange_n(&(pThis->pendingStore), 0, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < TS_POLYGEN_SNAPSHOTS; i++)
+    {
+        if (load & (1 << i))
+        {
+            _polyGenSnapshot* snapshot = &(pThis->snapshots[i]);
+            const _polyGenSnapshot* staged = &(pThis->stagedSnapshots[i]);
+            size_t tableBytes = staged->numPoints * sizeof(_polyGenVec);
+            memcpy(snapshot->points, staged->points, tableBytes);
+            memcpy(snapshot->lin, staged->lin, tableBytes);
+            memcpy(snapshot->quad, staged->quad, tableBytes);
+            snapshot->numPoints = staged->numPoints;
+            snapshot->useCurves = staged->useCurves;
+            snapshot->stored = staged->stored;
+            pThis->morphResample = true;
+        }
+        if (store & (1 << i))
+            storeSnapshot(pThis, i);
+    }
+    bool active = pThis->morphOn && pThis->snapshots[0].stored && pThis->snapshots[1].stored;
+    if (active != pThis->morphActive)
+    {
+        // Main shape's table changes under us
+        pThis->morphActive = active;
+        pThis->morph = -1.0f;
+        pThis->aaShapeIx = -1;
+        pThis->cacheDirty = true;
+    }
+    if (!active)
+        return;
+    if (pThis->morphResample)
+        resampleSnapshots(pThis);
+    // Takes the main shape's place in the frame
+    _polyGenShape* shape = &(pThis->morphShape);
+    shape->start = pThis->shapes[0].start;
+    shape->share = pThis->shapes[0].share;
+    shape->dtMult = static_cast<float>(shape->numVertices) / shape->share;
+
+    float morph = polyGenClamp(pThis->morphAmount + pThis->morphCV / TS_POLYGEN_MORPH_CV_V, 0.0f, 1.0f);
+    if (pThis->morph >= 0.0f && fabsf(morph - pThis->morph) < TS_POLYGEN_MORPH_EPSILON)
+        return;
+    // A + (B - A) * morph (B's resampled tables hold B - A)
+    const _polyGenSnapshot* a = &(pThis->snapshots[0]);
+    const _polyGenSnapshot* delta = &(pThis->snapshots[1]);
+    // Corners are A's at A, B's at B, and both in between
+    uint8_t aCorners = (morph < 1.0f) ? 1 : 0;
+    uint8_t bCorners = (morph > 0.0f) ? 1 : 0;
+    int lastCorner = -1, firstCorner = 0, cornerSpacing = shape->numPoints;
+    for (int i = 0; i < shape->numPoints; i++)
+    {
+        shape->corners[i] = (a->morphCorners[i] & aCorners) | (delta->morphCorners[i] & bCorners);
+        if (shape->corners[i])
+        {
+            if (lastCorner < 0)
+                firstCorner = i;
+            else if (i - lastCorner < cornerSpacing)
+                cornerSpacing = i - lastCorner;
+            lastCorner = i;
+        }
+        shape->points[i].x = a->morphPoints[i].x + delta->morphPoints[i].x * morph;
+        shape->points[i].y = a->morphPoints[i].y + delta->morphPoints[i].y * morph;
+        shape->lin[i].x = a->morphLin[i].x + delta->morphLin[i].x * morph;
+        shape->lin[i].y = a->morphLin[i].y + delta->morphLin[i].y * morph;
+        shape->quad[i].x = a->morphQuad[i].x + delta->morphQuad[i].x * morph;
+        shape->quad[i].y = a->morphQuad[i].y + delta->morphQuad[i].y * morph;
+    }
+    if (lastCorner >= 0 && firstCorner + shape->numPoints - lastCorner < cornerSpacing)
+        cornerSpacing = firstCorner + shape->numPoints - lastCorner;
+    shape->cornerSpacing = static_cast<float>(cornerSpacing);
+    pThis->morph = morph;
+    pThis->cacheDirty = true;
+    return;
+}
+
+// 2-point polyBLAMP/polyBLEP residuals for a corner that happened d samples (0 to 1) before this sample.
+// slopeDelta is the change in slope (per sample) and jump the change in value at the corner.
+// after is added to this sample, before to the previous sample. Both are scaled by weight.
+static inline void cornerCorrection(float d, float weight, const _polyGenVec& slopeDelta, const _polyGenVec& jump, _polyGenVec& after, _polyGenVec& before)
+{
+    d = polyGenClamp(d, 0.0f, 1.0f);
+    float e = 1.0f - d;
+    float rampAfter = weight * e * e * e / 6.0f;
+    float rampBefore = weight * d * d * d / 6.0f;
+    float stepAfter = -0.5f * weight * e * e;
+    float stepBefore = 0.5f * weight * d * d;
+    after.x = slopeDelta.x * rampAfter + jump.x * stepAfter;
+    after.y = slopeDelta.y * rampAfter + jump.y * stepAfter;
+    before.x = slopeDelta.x * rampBefore + jump.x * stepBefore;
+    before.y = slopeDelta.y * rampBefore + jump.y * stepBefore;
+    return;
+}
+
+// Clamp the X/Y outputs to the module's output range (offsets, shape scales and corner corrections can add up past it).
+static inline void clampOutputs(float* x, float* y, int numFrames)
+{
+    for (int i = 0; i < numFrames; i++)
+    {
+        x[i] = polyGenClamp(x[i], -TS_POLYGEN_OUTPUT_V_MAX, TS_POLYGEN_OUTPUT_V_MAX);
+        y[i] = polyGenClamp(y[i], -TS_POLYGEN_OUTPUT_V_MAX, TS_POLYGEN_OUTPUT_V_MAX);
+    }
+    return;
+}
+
+// Render a gate/trigger output from this block's corner events.
+// Goes high (level) for width samples after each event matching mask. remaining carries over to the next block.
+static inline void renderGate(const _polyGenEngineState* pThis, float* out, int numFrames, uint8_t mask, int width, float level, int& remaining)
+{
+    int frame = 0;
+    for (int e = 0; e <= pThis->numEvents; e++)
+    {
+        // Up to the next event (or the end of the block)
+        int end = numFrames;
+        if (e < pThis->numEvents)
+        {
+            if (!(pThis->eventTypes[e] & mask))
+                continue;
+            end = pThis->eventFrames[e];
+        }
+        int high = (remaining < end - frame) ? remaining : end - frame;
+        remaining -= high;
+        for (; high > 0; --high)
+            out[frame++] = level;
+        for (; frame < end; ++frame)
+            out[frame] = 0.0f;
+        remaining = (e < pThis->numEvents) ? width : remaining;
+    }
+    return;
+}
+
+// Wrap the rotation to -360 to 360 (just makes it simpler)
+static inline void wrapRotation(_polyGenEngineState* pThis)
+{
+    if (pThis->rotation_deg < -360 || pThis->rotation_deg > 360)
+    {
+        int n = static_cast<int>( fabsf(pThis->rotation_deg) / 360.0f + 0.5f );
+        if (pThis->rotation_deg >= 0.0f)
+            pThis->rotation_deg -= (n * 360);
+        else
+            pThis->rotation_deg += (n * 360);
+    }
+    pThis->rotation_rad = pThis->rotation_deg / 180.0f * TS_POLYGEN_PI;
+    return;
+}
+
+// Advance the spin (relative rotation) by numSamples.
+static inline void advanceSpin(_polyGenEngineState* pThis, int numSamples)
+{
+    // Rotations is N deg/second
+    pThis->rotation_deg += numSamples * pThis->spinPerSample_deg;
+    wrapRotation(pThis);
+    return;
+}
+
+// Base clock (whole frames per sample) for the given frequency input voltage. Negative if running backwards (Through-Zero).
+static inline float baseClock(const _polyGenEngineState* pThis, float inV)
+{
+    if (pThis->fmMode != FM_EXPONENTIAL)
+    {
+        float f = getFrequencyFromVoltage(pThis->frequencyParam_V) + pThis->fmDepth_HzPerV * inV;
+        if (pThis->fmMode == FM_LINEAR && f < 0.0f)
+            f = 0.0f;
+        return f * pThis->clockScale;
+    }
+    float input = polyGenClamp(inV + pThis->frequencyParam_V, static_cast<float>(TS_POLYGEN_FREQ_KNOB_MIN), static_cast<float>(TS_POLYGEN_FREQ_KNOB_MAX));
+    return polyGenExp2(input) * TS_POLYGEN_BASE_FREQ_HZ * pThis->clockScale;
+}
+
+// Linear/Through-Zero FM for this shape: dt = fmOffset + fmScale * input.
+static inline void linearFMScaling(const _polyGenEngineState* pThis, const _polyGenShape* shape, float& fmOffset, float& fmScale)
+{
+    fmOffset = getFrequencyFromVoltage(pThis->frequencyParam_V) * shape->dtMult * pThis->clockScale;
+    fmScale = pThis->fmDepth_HzPerV * shape->dtMult * pThis->clockScale;
+    return;
+}
+
+// Control rate setup for a block: the base clock at the first sample and its increment per sample,
+// and (if spinning) the increments of the rotation sin/cos to get to the end of the block.
+static inline void controlRateSetup(_polyGenEngineState* pThis, const float* in, int numFrames, bool advance,
+    float& baseDt, float& baseDtInc, float& sinInc, float& cosInc)
+{
+    baseDt = baseClock(pThis, in[0]);
+    baseDtInc = (numFrames > 1) ? (baseClock(pThis, in[numFrames - 1]) - baseDt) / (numFrames - 1) : 0.0f;
+    sinInc = 0.0f;
+    cosInc = 0.0f;
+    if (!pThis->rotationIsAbs && advance)
+    {
+        float sinrot = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+        float cosrot = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+        advanceSpin(pThis, numFrames);
+        sinInc = (TS_POLYGEN_SINFUNC( pThis->rotation_rad ) - sinrot) / numFrames;
+        cosInc = (TS_POLYGEN_COSFUNC( pThis->rotation_rad ) - cosrot) / numFrames;
+    }
+    return;
+}
+
+// Did going from vertex fromIx to toIx (backwards with reverse) pass a real corner? Every vertex is one,
+// except on the morph (see _polyGenShape::corners).
+static inline bool cornerPassed(const _polyGenShape* shape, int fromIx, int toIx, bool reverse)
+{
+    if (shape->corners == NULL)
+        return true;
+    int n = shape->numVertices;
+    int count = ((reverse) ? fromIx - toIx : toIx - fromIx) % n; // # vertices passed
+    if (count <= 0)
+        count += n;
+    // (Backwards we pass the starts of the edges after the one we are on now)
+    int ix = (reverse) ? toIx + 1 : fromIx + 1;
+    for (int i = 0; i < count; i++, ix++)
+    {
+        if (ix >= n)
+            ix -= n;
+        if (shape->corners[ix])
+            return true;
+    }
+    return false;
+}
+
+// Render the shapes sample by sample (Full and Control Rate quality).
+// frameOffset is where out1/out2 start in the block (for the corner events).
+// primary is false for the old tier during a crossfade (doesn't advance the spin or record events).
+static inline void renderShapes(_polyGenEngineState* pThis, const float* in, float* out1, float* out2, int numFrames, int frameOffset, bool controlRate, bool primary)
+{
+    float freq = pThis->frequencyParam_V;
+    bool recordEvents = primary && pThis->recordEvents;
+    _polyGenShape* shape = getShape(pThis, pThis->currShapeIx);
+    // Inner/2ndary vertex time (relative to the side) 
+    float iTime = 0.5f * (1 + pThis->innerAngleMult);
+    // Anti-aliasing: shortest edge with inner/2ndary vertices (relative to the side), the first half can reach the inner vertex early
+    float aaInnerSegment = fminf(iTime, 0.5f);
+    // Rotation only changes per sample if we are spinning
+    float sinrot = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+    float cosrot = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+    // Control rate: clock & spin at the ends of the block, interpolated in between
+    float baseDt = 0.0f, baseDtInc = 0.0f, sinInc = 0.0f, cosInc = 0.0f;
+    if (controlRate)
+        controlRateSetup(pThis, in, numFrames, primary, baseDt, baseDtInc, sinInc, cosInc);
+    // Linear/Through-Zero FM: scaling for the current shape (redone when the shape changes)
+    bool linearFM = pThis->fmMode != FM_EXPONENTIAL;
+    float fmOffset = 0.0f, fmScale = 0.0f;
+    if (linearFM)
+        linearFMScaling(pThis, shape, fmOffset, fmScale);
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        //=== * Rotation * ===
+        if (!pThis->rotationIsAbs)
+        {
+            if (controlRate)
+            {
+                sinrot += sinInc;
+                cosrot += cosInc;
+            }
+            else if (primary)
+            {
+                //----------------------------------------------------------
+                // Current rotation needs to be calculated every time then.
+                //----------------------------------------------------------
+                advanceSpin(pThis, 1);
+                sinrot = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+                cosrot = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+            }
+        }
+        //=== * Main Clock * ===
+        // Main Clock:
+        float dt;
+        if (controlRate)
+        {
+            dt = baseDt * shape->dtMult;
+            baseDt += baseDtInc;
+        }
+        else if (linearFM)
+        {
+            dt = fmOffset + fmScale * in[frame];
+            if (dt < 0.0f && pThis->fmMode == FM_LINEAR)
+                dt = 0.0f;
+        }
+        else
+        {
+            // Exponential: 2^x every sample (a clamp and polyGenExp2's polynomial, dearer than the multiply-add above),
+            // so audio-rate FM stays exact
+            float input = in[frame] + freq;
+            input = polyGenClamp(input, static_cast<float>(TS_POLYGEN_FREQ_KNOB_MIN), static_cast<float>(TS_POLYGEN_FREQ_KNOB_MAX));
+            // Want to draw N polygons per second (so multiply by # vertices, and by the share of the frame for this shape):
+            float f = polyGenExp2(input) * TS_POLYGEN_BASE_FREQ_HZ * shape->dtMult;
+            
+            float clockTime = f;
+            dt = clockTime * pThis->clockScale; // Real dt
+        }
+        pThis->phase += dt; // Main vertex phase
+        pThis->innerPhase += dt; // 2ndary/Inner vertex phase
+        bool reverse = dt < 0.0f; // Through-Zero, drawing backwards
+        // Anti-aliasing needs at least a sample per edge (more than one corner in a sample and the corner corrections
+        // pile up instead of cancelling the aliasing). Under that, the corners are drawn as if it was off.
+        bool antiAlias = false;
+        float aaSamples = 0.0f; // # samples on the shortest edge
+        if (pThis->antiAlias)
+        {
+            aaSamples = ((shape->useInnerVerts) ? aaInnerSegment : shape->cornerSpacing) / fabsf(dt);
+            antiAlias = aaSamples >= 1.0f;
+        }
+        
+        // Check for Next Side/Vertex
+        bool newCorner = false;
+        bool newShape = false;
+        bool newInnerCorner = false;
+        bool syncIn = false;
+        int prevVertexIx = pThis->currVertexIx;
+
+        if (pThis->innerPhase >= 1.0f)
+        {
+            pThis->innerPhase = 0.0f;
+        }
+        
+        if (pThis->phase >= 1.0f || syncIn)
+        {
+            if (syncIn)
+            {
+                pThis->phase = 0.0f;
+                pThis->currVertexIx = 0;
+            }
+            else
+            {
+                // (Soft) Reset main clock phase. With lots of sides we can pass more than one per sample.
+                int sides = static_cast<int>(pThis->phase);
+                pThis->phase -= sides;
+                pThis->currVertexIx += sides;
+            }
+            newCorner = true;
+            
+            while (pThis->currVertexIx >= shape->numVertices)
+            {
+                pThis->currVertexIx -= shape->numVertices;
+                if (pThis->numShapes > 1)
+                {
+                    // Next shape's turn (geometry is already calculated, so just switch the index)
+                    pThis->currShapeIx++;
+                    if (pThis->currShapeIx >= pThis->numShapes)
+                        pThis->currShapeIx = 0;
+                    shape = getShape(pThis, pThis->currShapeIx);
+                    newShape = true;
+                }
+                else
+                {
+                    pThis->currVertexIx %= shape->numVertices;
+                }
+            }
+
+            // (Hard) Reset inner/2ndary phase (for inner/2ndary vertices). Anti-aliased, keep the fraction so the edge is continuous.
+            pThis->innerPhase = (antiAlias) ? pThis->phase : 0;
+            pThis->innerSideIx = 0; // Reset the side we are on (for inner/2ndary vertices)
+            if (linearFM)
+                linearFMScaling(pThis, shape, fmOffset, fmScale);
+        }
+        else if (pThis->phase < 0.0f)
+        {
+            // Backwards (Through-Zero): previous side(s)/vertex
+            int sides = static_cast<int>(floorf(pThis->phase));
+            pThis->phase -= sides;
+            pThis->currVertexIx += sides;
+            newCorner = true;
+            while (pThis->currVertexIx < 0)
+            {
+                if (pThis->numShapes > 1)
+                {
+                    // Previous shape's turn
+                    pThis->currShapeIx--;
+                    if (pThis->currShapeIx < 0)
+                        pThis->currShapeIx = pThis->numShapes - 1;
+                    shape = getShape(pThis, pThis->currShapeIx);
+                    newShape = true;
+                    linearFMScaling(pThis, shape, fmOffset, fmScale);
+                }
+                pThis->currVertexIx += shape->numVertices;
+            }
+            // We come in at the end of the side (after the inner/2ndary vertex)
+            pThis->innerPhase = pThis->phase;
+            pThis->innerSideIx = 1;
+        }
+
+        // Which vertex we are on (outer/main)
+        if (pThis->currVertexIx >= shape->numVertices)
+            pThis->currVertexIx = 0;
+        pThis->nextVertexIx = pThis->currVertexIx + 1;
+        if (pThis->nextVertexIx >= shape->numVertices)
+            pThis->nextVertexIx = 0;
+
+        //=======================================
+        // The edge we are on (from the table)
+        //=======================================
+        float linearPhase = polyGenClamp(pThis->phase, 0.0f, 1.0f); // For interpolation
+        int edgeIx;
+        if (shape->useInnerVerts)
+        {
+            // Use our inner/2ndary phase to see where we are
+            linearPhase = polyGenClamp(pThis->innerPhase, 0.0f, 1.0f);
+            if (linearPhase < 0.5f)
+            {
+                // First Vertex then this middle inner one
+                edgeIx = 2 * pThis->currVertexIx;
+                linearPhase = linearPhase / iTime; // Rescale 0 to 1
+                if (pThis->innerSideIx == 1)
+                {
+                    // Passed the inner/2ndary vertex going backwards (Through-Zero)
+                    pThis->innerSideIx = 0;
+                    newInnerCorner = true;
+                }
+            }
+            else
+            {
+                // This middle inner one and then the 2nd vertex
+                edgeIx = 2 * pThis->currVertexIx + 1;
+                linearPhase = (linearPhase - 0.5f) / 0.5f;    // Rescale 0 to 1
+                if (pThis->innerSideIx == 0)
+                {
+                    // Passed the inner/2ndary vertex
+                    pThis->innerSideIx = 1;
+                    newInnerCorner = true;
+                }
+            }
+        } // end if inner/2ndary vertices
+        else
+        {
+            edgeIx = pThis->currVertexIx;
+        }
+        
+        // A real corner, not just the next point of a split up edge (morph)
+        bool realCorner = newShape || newInnerCorner || (newCorner && cornerPassed(shape, prevVertexIx, pThis->currVertexIx, reverse));
+
+        // Remember the corner for the gate outputs
+        if (recordEvents && realCorner && pThis->numEvents < TS_POLYGEN_EVENTS_MAX)
+        {
+            pThis->eventFrames[pThis->numEvents] = static_cast<uint16_t>(frameOffset + frame);
+            pThis->eventTypes[pThis->numEvents] = (newShape) ? (EVENT_CORNER | EVENT_RETRACE) : EVENT_CORNER;
+            pThis->numEvents++;
+        }
+        
+        //===============================
+        // Interpolate this step's value
+        //===============================
+        // Interpolate based on which point we are on this side
+        // We don't have to interpolate if it is a new corner
+        // (anti-aliased we keep interpolating so the corner lands between the samples)
+        // (backwards, the corner is at the end of the edge)
+        float mult = (newCorner && !antiAlias) ? ((reverse) ? 1.0f : 0.0f) : polyGenClamp(linearPhase, 0.0f, 1.0f);
+        const _polyGenVec& thisCorner = shape->points[edgeIx];
+        float vx, vy;
+        if (shape->useCurves)
+        {
+            // Quadratic Bezier straight from the table (Horner): P(t) = corner + (lin + quad*t)*t
+            // (2 multiply-adds per axis, no state to carry from sample to sample or drift)
+            const _polyGenVec& lin = shape->lin[edgeIx];
+            const _polyGenVec& quad = shape->quad[edgeIx];
+            vx = thisCorner.x + (lin.x + quad.x * mult) * mult;
+            vy = thisCorner.y + (lin.y + quad.y * mult) * mult;
+        }
+        else
+        {
+            // Simple linear interpolation
+            vx = thisCorner.x + shape->lin[edgeIx].x * mult;
+            vy = thisCorner.y + shape->lin[edgeIx].y * mult;
+        }
+        
+        //===============================
+        // Anti-Aliasing (only on the samples around a corner)
+        //===============================
+        bool rotate = !shape->resolved && pThis->rotation_deg != 0 && pThis->rotation_deg != 360;
+        if (pThis->antiAlias)
+        {
+            bool firstHalf = shape->useInnerVerts && !(edgeIx & 1);
+            bool edgeChanged = edgeIx != pThis->aaEdgeIx || pThis->currShapeIx != pThis->aaShapeIx;
+            // First half reaching the inner vertex before the mid point of the side (or leaving it again backwards)
+            bool saturationChanged = firstHalf && ((reverse) ? pThis->aaSaturated && linearPhase < 1.0f : !pThis->aaSaturated && linearPhase >= 1.0f);
+            if (antiAlias && pThis->aaShapeIx >= 0 && ((edgeChanged && realCorner) || saturationChanged))
+            {
+                // Slopes are per sample: t rate on the edge * dt
+                const _polyGenShape* prevShape = getShape(pThis, pThis->aaShapeIx);
+                float prevRate = dt, rate = dt;
+                if (prevShape->useInnerVerts)
+                    prevRate = (pThis->aaEdgeIx & 1) ? 2.0f * dt : dt / iTime;
+                if (shape->useInnerVerts)
+                    rate = (firstHalf) ? dt / iTime : 2.0f * dt;
+                int prevIx = pThis->aaEdgeIx;
+                _polyGenVec slopeDelta, jump = _polyGenVec(0.0f, 0.0f);
+                float d; // Samples since the corner
+                if (edgeChanged && reverse)
+                {
+                    // Previous edge (or previous shape), backwards: from the start of the last edge to the end of this one
+                    float tEnd = 1.0f;
+                    float slopeMult = rate;
+                    if (firstHalf)
+                    {
+                        // First half ends at the mid point of the side
+                        tEnd = polyGenClamp(0.5f / iTime, 0.0f, 1.0f);
+                        if (linearPhase >= 1.0f)
+                            slopeMult = 0.0f; // Still sitting on the inner vertex
+                    }
+                    _polyGenVec endPoint = thisCorner;
+                    endPoint.x += (shape->lin[edgeIx].x + shape->quad[edgeIx].x * tEnd) * tEnd;
+                    endPoint.y += (shape->lin[edgeIx].y + shape->quad[edgeIx].y * tEnd) * tEnd;
+                    jump.x = endPoint.x - prevShape->points[prevIx].x;
+                    jump.y = endPoint.y - prevShape->points[prevIx].y;
+                    slopeDelta.x = (shape->lin[edgeIx].x + 2.0f * shape->quad[edgeIx].x * tEnd) * slopeMult - prevShape->lin[prevIx].x * prevRate;
+                    slopeDelta.y = (shape->lin[edgeIx].y + 2.0f * shape->quad[edgeIx].y * tEnd) * slopeMult - prevShape->lin[prevIx].y * prevRate;
+                    d = (newCorner) ? (pThis->phase - 1.0f) / dt : (pThis->innerPhase - 0.5f) / dt;
+                    if (firstHalf)
+                        pThis->aaSaturated = linearPhase >= 1.0f;
+                }
+                else if (edgeChanged)
+                {
+                    // Next edge (or next shape): from the end of the last edge to the start of this one
+                    float tEnd = 1.0f;
+                    float prevSlopeMult = prevRate;
+                    if (prevShape->useInnerVerts && !(prevIx & 1))
+                    {
+                        // First half ends at the mid point of the side
+                        tEnd = polyGenClamp(0.5f / iTime, 0.0f, 1.0f);
+                        if (pThis->aaSaturated)
+                            prevSlopeMult = 0.0f;
+                    }
+                    _polyGenVec endPoint = prevShape->points[prevIx];
+                    endPoint.x += (prevShape->lin[prevIx].x + prevShape->quad[prevIx].x * tEnd) * tEnd;
+                    endPoint.y += (prevShape->lin[prevIx].y + prevShape->quad[prevIx].y * tEnd) * tEnd;
+                    jump.x = thisCorner.x - endPoint.x;
+                    jump.y = thisCorner.y - endPoint.y;
+                    slopeDelta.x = shape->lin[edgeIx].x * rate - (prevShape->lin[prevIx].x + 2.0f * prevShape->quad[prevIx].x * tEnd) * prevSlopeMult;
+                    slopeDelta.y = shape->lin[edgeIx].y * rate - (prevShape->lin[prevIx].y + 2.0f * prevShape->quad[prevIx].y * tEnd) * prevSlopeMult;
+                    d = (newCorner) ? pThis->phase / dt : (pThis->innerPhase - 0.5f) / dt;
+                    if (firstHalf)
+                        pThis->aaSaturated = linearPhase >= 1.0f;
+                }
+                else
+                {
+                    // First half reached the inner vertex before the mid point of the side, it stops there
+                    // (backwards, it starts moving again)
+                    float sign = (reverse) ? 1.0f : -1.0f;
+                    slopeDelta.x = sign * (shape->lin[edgeIx].x + 2.0f * shape->quad[edgeIx].x) * rate;
+                    slopeDelta.y = sign * (shape->lin[edgeIx].y + 2.0f * shape->quad[edgeIx].y) * rate;
+                    d = (pThis->innerPhase - iTime) / dt;
+                    pThis->aaSaturated = !reverse;
+                }
+                // (Faded in from 1 sample per edge, so sweeping the pitch through it does not click, and corners
+                // closer than 2 samples apart only get part of it as their 2-sample residuals overlap)
+                float weight = polyGenClamp((aaSamples - 1.0f) / TS_POLYGEN_AA_FADE_SAMPLES, 0.0f, 1.0f);
+                _polyGenVec after, before;
+                cornerCorrection(d, weight, slopeDelta, jump, after, before);
+                vx += after.x;
+                vy += after.y;
+                if (frame > 0)
+                {
+                    // Previous sample is still in our buffer (it is lost if the corner was right at the start of the block)
+                    if (rotate)
+                    {
+                        out1[frame - 1] += before.x * cosrot - before.y * sinrot;
+                        out2[frame - 1] += before.x * sinrot + before.y * cosrot;
+                    }
+                    else
+                    {
+                        out1[frame - 1] += before.x;
+                        out2[frame - 1] += before.y;
+                    }
+                }
+            }
+            else if (edgeChanged || saturationChanged)
+            {
+                pThis->aaSaturated = firstHalf && linearPhase >= 1.0f;
+            }
+            pThis->aaShapeIx = pThis->currShapeIx;
+            pThis->aaEdgeIx = edgeIx;
+        }
+
+        //===============================
+        // Rotate the point
+        //===============================
+        float vxR, vyR;
+        vxR = vx;
+        vyR = vy;
+        
+        if (rotate)
+        {
+            // Translate to rotation center
+            vx -= pThis->xCRot;
+            vy -= pThis->yCRot;
+            
+            // Rotate
+            vxR = vx * cosrot - vy * sinrot;
+            vyR = vx * sinrot + vy * cosrot;
+            
+            // Translate back after rotation
+            vxR += pThis->xCRot;
+            vyR += pThis->yCRot;
+        }
+        
+        //================================
+        // Post Rotation Offset
+        //================================
+        if (!shape->resolved)
+        {
+            vxR += pThis->xOffset;
+            vyR += pThis->yOffset;
+        }
+
+        //================================
+        // Outputs
+        //================================
+        
+        // CHANNEL 0 (X)
+        out1[frame] = vxR;
+        // CHANNEL 1 (Y)
+        out2[frame] = vyR;
+    }
+
+    return;
+}
+
+// Find where we are in the whole frame (all shapes) for the frame phase u (0 to 1).
+static inline void scenePosition(const _polyGenEngineState* pThis, float u, int& shapeIx, int& vertexIx, float& phase)
+{
+    if (u >= 1.0f)
+        u -= 1.0f;
+    shapeIx = pThis->numShapes - 1;
+    for (int i = 0; i < pThis->numShapes - 1; i++)
+    {
+        if (u < pThis->shapes[i].start + pThis->shapes[i].share)
+        {
+            shapeIx = i;
+            break;
+        }
+    }
+    const _polyGenShape* shape = getShape(pThis, shapeIx);
+    float local = polyGenClamp((u - shape->start) / shape->share, 0.0f, 1.0f) * shape->numVertices;
+    vertexIx = static_cast<int>(local);
+    if (vertexIx >= shape->numVertices)
+        vertexIx = shape->numVertices - 1;
+    phase = polyGenClamp(local - vertexIx, 0.0f, 1.0f);
+    return;
+}
+
+// Point on a shape (before the main rotation/offset) for the given vertex & phase, straight from the table.
+static inline _polyGenVec evaluatePoint(const _polyGenEngineState* pThis, const _polyGenShape* shape, int vertexIx, float phase)
+{
+    int edgeIx = vertexIx;
+    float t = phase;
+    if (shape->useInnerVerts)
+    {
+        float iTime = 0.5f * (1 + pThis->innerAngleMult);
+        edgeIx = (phase < 0.5f) ? 2 * vertexIx : 2 * vertexIx + 1;
+        t = (phase < 0.5f) ? phase / iTime : (phase - 0.5f) / 0.5f;
+    }
+    t = polyGenClamp(t, 0.0f, 1.0f);
+    _polyGenVec point = shape->points[edgeIx];
+    point.x += (shape->lin[edgeIx].x + shape->quad[edgeIx].x * t) * t;
+    point.y += (shape->lin[edgeIx].y + shape->quad[edgeIx].y * t) * t;
+    return point;
+}
+
+// Build part of the cached cycle into the back buffer, swapping it in when it is done.
+// Spread over blocks so a geometry change doesn't cost a whole cycle at once.
+static inline void buildCache(_polyGenEngineState* pThis, int numPoints)
+{
+    // (Changed during a build: finish that one first, so a morph that keeps moving still refreshes the cache)
+    if (pThis->cacheDirty && (pThis->cacheBuildIx >= TS_POLYGEN_CACHE_SIZE || !pThis->cacheValid))
+    {
+        pThis->cacheBuildIx = 0;
+        pThis->cacheDirty = false;
+    }
+    if (pThis->cacheBuildIx >= TS_POLYGEN_CACHE_SIZE || pThis->shapes[0].numPoints == 0)
+        return;
+    int back = 1 - pThis->cacheFront;
+    int end = pThis->cacheBuildIx + numPoints;
+    if (end > TS_POLYGEN_CACHE_SIZE)
+        end = TS_POLYGEN_CACHE_SIZE;
+    int shapeIx, vertexIx, nextShapeIx, nextVertexIx;
+    float phase, nextPhase;
+    scenePosition(pThis, static_cast<float>(pThis->cacheBuildIx) / TS_POLYGEN_CACHE_SIZE, shapeIx, vertexIx, phase);
+    for (int i = pThis->cacheBuildIx; i < end; i++)
+    {
+        const _polyGenShape* shape = getShape(pThis, shapeIx);
+        pThis->cachePoints[back][i] = evaluatePoint(pThis, shape, vertexIx, phase);
+        // Any corners before the next entry?
+        scenePosition(pThis, static_cast<float>(i + 1) / TS_POLYGEN_CACHE_SIZE, nextShapeIx, nextVertexIx, nextPhase);
+        uint8_t events = 0;
+        if (nextShapeIx != shapeIx)
+            events = EVENT_CORNER | EVENT_RETRACE;
+        else if (nextVertexIx != vertexIx)
+            events = (cornerPassed(shape, vertexIx, nextVertexIx, false)) ? EVENT_CORNER : 0;
+        else if (shape->useInnerVerts && phase < 0.5f && nextPhase >= 0.5f)
+            events = EVENT_CORNER;
+        if (shape->resolved)
+            events |= TS_POLYGEN_CACHE_RESOLVED; // Playback leaves out the main rotation/offset
+        pThis->cacheEvents[back][i] = events;
+        shapeIx = nextShapeIx;
+        vertexIx = nextVertexIx;
+        phase = nextPhase;
+    }
+    pThis->cacheBuildIx = end;
+    if (end == TS_POLYGEN_CACHE_SIZE)
+    {
+        pThis->cacheFront = back;
+        pThis->cacheValid = true;
+    }
+    return;
+}
+
+// Play back the cached cycle (Cached quality): the cost doesn't depend on the shapes at all.
+static inline void renderCached(_polyGenEngineState* pThis, const float* in, float* out1, float* out2, int numFrames, int frameOffset, bool primary)
+{
+    bool recordEvents = primary && pThis->recordEvents;
+    const _polyGenVec* cache = pThis->cachePoints[pThis->cacheFront];
+    const uint8_t* cacheEvents = pThis->cacheEvents[pThis->cacheFront];
+    float sinrot = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+    float cosrot = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+    float baseDt, baseDtInc, sinInc, cosInc;
+    controlRateSetup(pThis, in, numFrames, primary, baseDt, baseDtInc, sinInc, cosInc);
+    bool rotate = pThis->rotation_deg != 0 && pThis->rotation_deg != 360;
+    float pos = pThis->cachePhase * TS_POLYGEN_CACHE_SIZE;
+    int lastIx = pThis->cacheIx;
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        sinrot += sinInc;
+        cosrot += cosInc;
+        float step = baseDt * TS_POLYGEN_CACHE_SIZE;
+        pos += step;
+        baseDt += baseDtInc;
+        if (pos >= TS_POLYGEN_CACHE_SIZE)
+            pos -= TS_POLYGEN_CACHE_SIZE;
+        else if (pos < 0.0f)
+            pos += TS_POLYGEN_CACHE_SIZE; // Backwards (Through-Zero)
+        int ix = static_cast<int>(pos);
+        if (ix >= TS_POLYGEN_CACHE_SIZE)
+            ix = TS_POLYGEN_CACHE_SIZE - 1;
+        if (ix != lastIx)
+        {
+            // Events are between entry i and i+1, so backwards it is the one we went into
+            int eventIx = (step < 0.0f) ? ix : lastIx;
+            uint8_t events = cacheEvents[eventIx] & ~TS_POLYGEN_CACHE_RESOLVED;
+            if (recordEvents && events && pThis->numEvents < TS_POLYGEN_EVENTS_MAX)
+            {
+                pThis->eventFrames[pThis->numEvents] = static_cast<uint16_t>(frameOffset + frame);
+                pThis->eventTypes[pThis->numEvents] = events;
+                pThis->numEvents++;
+            }
+            lastIx = ix;
+        }
+        float frac = pos - ix;
+        const _polyGenVec& p0 = cache[ix];
+        const _polyGenVec& p1 = cache[(ix + 1) & (TS_POLYGEN_CACHE_SIZE - 1)];
+        float vx = p0.x + (p1.x - p0.x) * frac;
+        float vy = p0.y + (p1.y - p0.y) * frac;
+        if (cacheEvents[ix] & TS_POLYGEN_CACHE_RESOLVED)
+        {
+            out1[frame] = vx;
+            out2[frame] = vy;
+            continue;
+        }
+        float vxR = vx, vyR = vy;
+        if (rotate)
+        {
+            vx -= pThis->xCRot;
+            vy -= pThis->yCRot;
+            vxR = vx * cosrot - vy * sinrot + pThis->xCRot;
+            vyR = vx * sinrot + vy * cosrot + pThis->yCRot;
+        }
+        out1[frame] = vxR + pThis->xOffset;
+        out2[frame] = vyR + pThis->yOffset;
+    }
+    pThis->cachePhase = pos / TS_POLYGEN_CACHE_SIZE;
+    pThis->cacheIx = lastIx;
+    return;
+}
+
+// Render with the given quality tier.
+static inline void renderTier(_polyGenEngineState* pThis, uint8_t tier, const float* in, float* out1, float* out2, int numFrames, int frameOffset, bool primary)
+{
+    if (tier == TIER_CACHED)
+        renderCached(pThis, in, out1, out2, numFrames, frameOffset, primary);
+    else
+        renderShapes(pThis, in, out1, out2, numFrames, frameOffset, tier == TIER_CONTROL_RATE, primary);
+    return;
+}
+
+// Where the shapes are in the whole frame (0 to 1), for moving over to the cached cycle or LFO mode.
+static inline float framePhase(const _polyGenEngineState* pThis)
+{
+    const _polyGenShape* shape = getShape(pThis, pThis->currShapeIx);
+    float u = shape->start + shape->share * (pThis->currVertexIx + polyGenClamp(pThis->phase, 0.0f, 1.0f)) / shape->numVertices;
+    return (u >= 1.0f) ? u - 1.0f : u;
+}
+
+// Put the shapes at frame phase u (0 to 1), coming back from the cached cycle or LFO mode.
+static inline void setFramePhase(_polyGenEngineState* pThis, float u)
+{
+    scenePosition(pThis, u, pThis->currShapeIx, pThis->currVertexIx, pThis->phase);
+    pThis->innerPhase = pThis->phase;
+    pThis->innerSideIx = (pThis->phase >= 0.5f) ? 1 : 0;
+    pThis->aaShapeIx = -1;
+    return;
+}
+
+// Put the cached cycle's playback at frame phase u (0 to 1).
+static inline void setCachePhase(_polyGenEngineState* pThis, float u)
+{
+    pThis->cachePhase = u;
+    pThis->cacheIx = static_cast<int>(pThis->cachePhase * TS_POLYGEN_CACHE_SIZE) & (TS_POLYGEN_CACHE_SIZE - 1);
+    return;
+}
+
+// Pick the quality tier for this block. Going in or out of Cached moves the state over and starts a crossfade
+// (Full <-> Control Rate share the same state, so they are continuous anyway).
+static inline void updateTier(_polyGenEngineState* pThis)
+{
+    uint8_t tier = (pThis->qualityMode == QUALITY_AUTO) ? pThis->autoTier : pThis->qualityMode - 1;
+    if (tier == TIER_CACHED && !pThis->cacheValid)
+        tier = TIER_CONTROL_RATE; // Not ready yet
+    if (tier == pThis->tier)
+        return;
+    if ((tier == TIER_CACHED) != (pThis->tier == TIER_CACHED))
+    {
+        if (tier == TIER_CACHED)
+        {
+            setCachePhase(pThis, framePhase(pThis));
+        }
+        else
+        {
+            // Back to the shapes from where we are in the cached frame
+            setFramePhase(pThis, pThis->cachePhase);
+        }
+        pThis->xfadeFromTier = pThis->tier;
+        pThis->xfadeRemaining = TS_POLYGEN_XFADE_SAMPLES;
+    }
+    pThis->tier = tier;
+    return;
+}
+
+// Point at frame phase u (0 to 1) with the main rotation & offset, straight from the tables (LFO mode).
+static inline _polyGenVec lfoEvaluate(_polyGenEngineState* pThis, float u, int& shapeIx, int& vertexIx, float& phase)
+{
+    scenePosition(pThis, u, shapeIx, vertexIx, phase);
+    const _polyGenShape* shape = getShape(pThis, shapeIx);
+    _polyGenVec point = evaluatePoint(pThis, shape, vertexIx, phase);
+    if (shape->resolved)
+        return point;
+    if (pThis->rotation_deg != 0 && pThis->rotation_deg != 360)
+    {
+        // sin/cos only when the rotation moved (spinning)
+        if (pThis->rotation_rad != pThis->lfoRotation_rad)
+        {
+            pThis->lfoRotation_rad = pThis->rotation_rad;
+            pThis->lfoSin = TS_POLYGEN_SINFUNC( pThis->rotation_rad );
+            pThis->lfoCos = TS_POLYGEN_COSFUNC( pThis->rotation_rad );
+        }
+        float vx = point.x - pThis->xCRot;
+        float vy = point.y - pThis->yCRot;
+        point.x = vx * pThis->lfoCos - vy * pThis->lfoSin + pThis->xCRot;
+        point.y = vx * pThis->lfoSin + vy * pThis->lfoCos + pThis->yCRot;
+    }
+    point.x += pThis->xOffset;
+    point.y += pThis->yOffset;
+    return point;
+}
+
+// Going in or out of LFO mode (at the start of a block): carry on from the same place in the frame.
+static inline void updateLFO(_polyGenEngineState* pThis)
+{
+    if (pThis->lfoMode == pThis->lfoActive)
+        return;
+    if (pThis->lfoMode)
+    {
+        pThis->lfoPhase = (pThis->tier == TIER_CACHED) ? pThis->cachePhase : framePhase(pThis);
+        pThis->xfadeRemaining = 0;
+        int shapeIx, vertexIx;
+        float phase;
+        pThis->lfoPoint = lfoEvaluate(pThis, pThis->lfoPhase, shapeIx, vertexIx, phase);
+    }
+    else
+    {
+        // Whichever tier picks up (Full/Control Rate or Cached)
+        setFramePhase(pThis, pThis->lfoPhase);
+        setCachePhase(pThis, pThis->lfoPhase);
+    }
+    pThis->lfoActive = pThis->lfoMode;
+    return;
+}
+
+// Render in LFO mode: the clock, spin and shape are worked out once per segment (TS_POLYGEN_LFO_SEGMENT samples at most)
+// and the outputs are a linear ramp from the last point, so the per sample cost is just the ramp.
+// Edges are straight lines anyway; only corners (and curves) closer together than a segment get cut.
+static inline void renderLFO(_polyGenEngineState* pThis, const float* in, float* out1, float* out2, int numFrames, int frameOffset)
+{
+    // Where the last segment ended (only needed for the corner events)
+    int shapeIx = 0, vertexIx = 0;
+    float phase = 0.0f;
+    if (pThis->recordEvents)
+        scenePosition(pThis, pThis->lfoPhase, shapeIx, vertexIx, phase);
+    int frame = 0;
+    while (frame < numFrames)
+    {
+        int n = numFrames - frame;
+        if (n > TS_POLYGEN_LFO_SEGMENT)
+            n = TS_POLYGEN_LFO_SEGMENT;
+        // Clock at the end of the segment for the whole segment (either way for Through-Zero)
+        float inV = in[frame + n - 1];
+        if (inV != pThis->lfoClockIn)
+        {
+            pThis->lfoClockIn = inV;
+            pThis->lfoClock = baseClock(pThis, inV);
+        }
+        pThis->lfoPhase += pThis->lfoClock * n;
+        if (pThis->lfoPhase >= 1.0f)
+            pThis->lfoPhase -= 1.0f;
+        else if (pThis->lfoPhase < 0.0f)
+            pThis->lfoPhase += 1.0f; // Backwards (Through-Zero)
+        if (!pThis->rotationIsAbs)
+            advanceSpin(pThis, n);
+        int nextShapeIx, nextVertexIx;
+        float nextPhase;
+        _polyGenVec point = lfoEvaluate(pThis, pThis->lfoPhase, nextShapeIx, nextVertexIx, nextPhase);
+
+        // Any corners in this segment? (marked at the end of it)
+        if (pThis->recordEvents && pThis->numEvents < TS_POLYGEN_EVENTS_MAX)
+        {
+            uint8_t events = 0;
+            if (nextShapeIx != shapeIx)
+                events = EVENT_CORNER | EVENT_RETRACE;
+            else if (nextVertexIx != vertexIx)
+                events = (cornerPassed(getShape(pThis, shapeIx), vertexIx, nextVertexIx, pThis->lfoClock < 0.0f)) ? EVENT_CORNER : 0;
+            else if (getShape(pThis, shapeIx)->useInnerVerts && (phase < 0.5f) != (nextPhase < 0.5f))
+                events = EVENT_CORNER;
+            if (events)
+            {
+                pThis->eventFrames[pThis->numEvents] = static_cast<uint16_t>(frameOffset + frame + n - 1);
+                pThis->eventTypes[pThis->numEvents] = events;
+                pThis->numEvents++;
+            }
+        }
+
+        // Ramp (no dependency between samples, so the compiler can vectorize it)
+        float x0 = pThis->lfoPoint.x;
+        float y0 = pThis->lfoPoint.y;
+        float xInc = (point.x - x0) / n;
+        float yInc = (point.y - y0) / n;
+        float* x = out1 + frame;
+        float* y = out2 + frame;
+        for (int i = 0; i < n; i++)
+        {
+            float k = static_cast<float>(i + 1);
+            x[i] = x0 + xInc * k;
+            y[i] = y0 + yInc * k;
+        }
+        pThis->lfoPoint = point;
+        shapeIx = nextShapeIx;
+        vertexIx = nextVertexIx;
+        phase = nextPhase;
+        frame += n;
+    }
+    return;
+}
+
+// Auto quality: compare the time a block took against this instance's share of the block and move down a tier
+// if we are over budget, or back up if well under it. The hold time (hysteresis) keeps it from flapping.
+static inline void updateGovernor(_polyGenEngineState* pThis, uint32_t cycles, int numFrames)
+{
+    if (pThis->qualityMode != QUALITY_AUTO)
+        return;
+    if (cycles == 0)
+    {
+        // No cycle counter, so no load to go by: stay on a fixed tier, cheaper than Full
+        pThis->autoTier = TS_POLYGEN_GOVERNOR_FALLBACK;
+        return;
+    }
+    float load = static_cast<float>(cycles) / (numFrames * pThis->cpuCyclesPerSample);
+    pThis->cpuLoad += (load - pThis->cpuLoad) * TS_POLYGEN_GOVERNOR_SMOOTHING;
+    pThis->governorHold -= numFrames;
+    if (pThis->governorHold > 0)
+        return;
+    if (pThis->cpuLoad > pThis->cpuBudget && pThis->autoTier < TIER_CACHED)
+    {
+        pThis->autoTier++;
+        pThis->governorHold = pThis->governorHoldSamples;
+    }
+    else if (pThis->cpuLoad < pThis->cpuBudget * TS_POLYGEN_GOVERNOR_UP_RATIO && pThis->autoTier > TIER_FULL)
+    {
+        pThis->autoTier--;
+        pThis->governorHold = pThis->governorHoldSamples;
+    }
+    return;
+}
+
+//=== * Engine API * ===
+
+inline uint32_t _polyGenEngine::memorySize()
+{
+    // Shape tables, snapshot, staged snapshot & morph tables (and their corner flags), cached cycle (double buffered)
+    return TS_POLYGEN_SHAPES_MAX * 3 * TS_POLYGEN_POINTS_MAX * sizeof(_polyGenVec)
+        + (TS_POLYGEN_SNAPSHOTS * 9 + 3) * TS_POLYGEN_POINTS_MAX * sizeof(_polyGenVec)
+        + (TS_POLYGEN_SNAPSHOTS + 1) * TS_POLYGEN_POINTS_MAX * sizeof(uint8_t)
+        + 2 * TS_POLYGEN_CACHE_SIZE * (sizeof(_polyGenVec) + sizeof(uint8_t));
+}
+
+inline void _polyGenEngine::setMemory(uint8_t* memory)
+{
+    for (int i = 0; i < TS_POLYGEN_SHAPES_MAX; i++)
+    {
+        _polyGenVec* tables = reinterpret_cast<_polyGenVec*>(memory);
+        shapes[i].points = tables;
+        shapes[i].lin = tables + TS_POLYGEN_POINTS_MAX;
+        shapes[i].quad = tables + 2 * TS_POLYGEN_POINTS_MAX;
+        memory += 3 * TS_POLYGEN_POINTS_MAX * sizeof(_polyGenVec);
+    }
+    for (int i = 0; i < TS_POLYGEN_SNAPSHOTS; i++)
+    {
+        _polyGenVec* tables = reinterpret_cast<_polyGenVec*>(memory);
+        _polyGenSnapshot* snapshot = &(snapshots[i]);
+        snapshot->points = tables;
+        snapshot->lin = tables + TS_POLYGEN_POINTS_MAX;
+        snapshot->quad = tables + 2 * TS_POLYGEN_POINTS_MAX;
+        snapshot->morphPoints = tables + 3 * TS_POLYGEN_POINTS_MAX;
+        snapshot->morphLin = tables + 4 * TS_POLYGEN_POINTS_MAX;
+        snapshot->morphQuad = tables + 5 * TS_POLYGEN_POINTS_MAX;
+        _polyGenSnapshot* staged = &(stagedSnapshots[i]);
+        staged->points = tables + 6 * TS_POLYGEN_POINTS_MAX;
+        staged->lin = tables + 7 * TS_POLYGEN_POINTS_MAX;
+        staged->quad = tables + 8 * TS_POLYGEN_POINTS_MAX;
+        memory += 9 * TS_POLYGEN_POINTS_MAX * sizeof(_polyGenVec);
+    }
+    {
+        _polyGenVec* tables = reinterpret_cast<_polyGenVec*>(memory);
+        morphShape.points = tables;
+        morphShape.lin = tables + TS_POLYGEN_POINTS_MAX;
+        morphShape.quad = tables + 2 * TS_POLYGEN_POINTS_MAX;
+        morphShape.resolved = true;
+        memory += 3 * TS_POLYGEN_POINTS_MAX * sizeof(_polyGenVec);
+    }
+    for (int i = 0; i < TS_POLYGEN_SNAPSHOTS; i++)
+    {
+        snapshots[i].morphCorners = memory;
+        memory += TS_POLYGEN_POINTS_MAX;
+    }
+    morphShape.corners = memory;
+    memory += TS_POLYGEN_POINTS_MAX;
+    for (int i = 0; i < 2; i++)
+    {
+        cachePoints[i] = reinterpret_cast<_polyGenVec*>(memory);
+        memory += TS_POLYGEN_CACHE_SIZE * sizeof(_polyGenVec);
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        cacheEvents[i] = memory;
+        memory += TS_POLYGEN_CACHE_SIZE;
+    }
+    return;
+}
+
+inline void _polyGenEngine::prepare(float sRate)
+{
+    sampleRate = (sRate > 0.0f) ? sRate : 1000.0f;
+    invSampleRate = 1.0f / sampleRate;
+    clockScale = (lfoMode) ? invSampleRate / (1 << TS_POLYGEN_LFO_OCTAVES) : invSampleRate;
+    lfoClockIn = NAN;
+    spinPerSample_deg = rotationKnob_deg / sampleRate;
+    cpuCyclesPerSample = TS_POLYGEN_CPU_HZ / sampleRate;
+    governorHoldSamples = static_cast<int>(TS_POLYGEN_GOVERNOR_HOLD_MS * sampleRate / 1000);
+    triggerWidth = static_cast<int>(triggerWidth_ms * sampleRate / 1000.0f + 0.5f);
+    blankWidth = static_cast<int>(blankWidth_ms * sampleRate / 1000.0f + 0.5f);
+    return;
+}
+
+inline void _polyGenEngine::process(const float* voct, float* x, float* y, int numFrames)
+{
+    if (geometryDirty & ((1 << numShapes) - 1))
+        rebuildGeometry(this);
+    numEvents = 0;
+
+    //=== * Morph (once per block) * ===
+    updateMorph(this);
+
+    //=== * LFO Mode (instead of the quality tiers) * ===
+    updateLFO(this);
+    if (lfoActive)
+    {
+        renderLFO(this, voct, x, y, numFrames, 0);
+        clampOutputs(x, y, numFrames);
+        return;
+    }
+
+    //=== * Quality (Full, Control Rate or Cached) * ===
+    updateTier(this);
+    if (qualityMode == QUALITY_AUTO || qualityMode == QUALITY_CACHED)
+        buildCache(this, TS_POLYGEN_CACHE_BUILD_CHUNK);
+    int frame = 0;
+    while (xfadeRemaining > 0 && frame < numFrames)
+    {
+        // Crossfade from the old tier to the new one (the old tier runs on its own state)
+        int n = numFrames - frame;
+        if (n > TS_POLYGEN_XFADE_CHUNK)
+            n = TS_POLYGEN_XFADE_CHUNK;
+        if (n > xfadeRemaining)
+            n = xfadeRemaining;
+        renderTier(this, xfadeFromTier, voct + frame, xfadeX, xfadeY, n, frame, false);
+        renderTier(this, tier, voct + frame, x + frame, y + frame, n, frame, true);
+        for (int i = 0; i < n; i++)
+        {
+            float mix = static_cast<float>(xfadeRemaining - i) / TS_POLYGEN_XFADE_SAMPLES; // Amount of old tier
+            x[frame + i] += (xfadeX[i] - x[frame + i]) * mix;
+            y[frame + i] += (xfadeY[i] - y[frame + i]) * mix;
+        }
+        xfadeRemaining -= n;
+        frame += n;
+    }
+    if (frame < numFrames)
+        renderTier(this, tier, voct + frame, x + frame, y + frame, numFrames - frame, frame, true);
+    clampOutputs(x, y, numFrames);
+    return;
+}
+
+inline void _polyGenEngine::renderGates(float* trigger, float* blank, int numFrames)
+{
+    if (trigger != NULL)
+        renderGate(this, trigger, numFrames, EVENT_CORNER, triggerWidth, TS_POLYGEN_TRIGGER_V, triggerRemaining);
+    if (blank != NULL)
+        renderGate(this, blank, numFrames, blankMask, blankWidth, blankLevel, blankRemaining);
+    return;
+}
+
+inline void _polyGenEngine::setFrequency(float volts)
+{
+    frequencyParam_V = polyGenClamp(volts, static_cast<float>(TS_POLYGEN_FREQ_KNOB_MIN), static_cast<float>(TS_POLYGEN_FREQ_KNOB_MAX));
+    lfoClockIn = NAN;
+    return;
+}
+
+inline void _polyGenEngine::setFMMode(uint8_t mode)
+{
+    fmMode = mode;
+    lfoClockIn = NAN;
+    return;
+}
+
+inline void _polyGenEngine::setFMDepth(float hzPerV)
+{
+    fmDepth_HzPerV = hzPerV;
+    lfoClockIn = NAN;
+    return;
+}
+
+inline void _polyGenEngine::setNumVertices(int n)
+{
+    numVertices = static_cast<uint16_t>(n);
+    geometryDirty |= 0x01; // Just the main shape
+    return;
+}
+
+inline void _polyGenEngine::setAngleOffset(float degrees)
+{
+    angleOffset_rad = degrees * TS_POLYGEN_PI / 180.0f;
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setInnerRadius(float mult)
+{
+    innerRadiusMult = mult;
+    // See if we even have to worry about inner (2ndary) vertices (ignore if very close to 100%)
+    const float threshold = 0.0005f;
+    float radiusDiff = 1.0f - innerRadiusMult;
+    useInnerVerts = radiusDiff < -threshold || radiusDiff > threshold;
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setInnerAngle(float mult)
+{
+    innerAngleMult = mult;
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setCurvature(float c)
+{
+    curvature = c;
+    useCurves = c != 0.0f;
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setAmplitude(float x, float y)
+{
+    xAmpl = polyGenClamp(x, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    yAmpl = polyGenClamp(y, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setOffset(float x, float y)
+{
+    xOffset = polyGenClamp(x, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    yOffset = polyGenClamp(y, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    return;
+}
+
+inline void _polyGenEngine::setRotationCenter(float x, float y)
+{
+    xCRot = polyGenClamp(x, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    yCRot = polyGenClamp(y, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    return;
+}
+
+// Absolute rotation (degrees), or the spin rate (degrees/s) while spinning
+inline void _polyGenEngine::setRotation(float degrees)
+{
+    rotationKnob_deg = -1.0f * degrees;
+    spinPerSample_deg = rotationKnob_deg / sampleRate;
+    if (rotationIsAbs)
+        rotation_deg = rotationKnob_deg;
+    else
+        rotation_deg += spinPerSample_deg;
+    wrapRotation(this);
+    return;
+}
+
+inline void _polyGenEngine::setSpin(bool spin)
+{
+    rotationIsAbs = !spin;
+    if (rotationIsAbs)
+    {
+        rotation_deg = rotationKnob_deg;
+        wrapRotation(this);
+    }
+    return;
+}
+
+inline void _polyGenEngine::setAntiAlias(bool on)
+{
+    antiAlias = on;
+    aaShapeIx = -1;
+    return;
+}
+
+inline void _polyGenEngine::setNumShapes(int n)
+{
+    numShapes = static_cast<uint8_t>(n);
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setShapeShare(bool bySides)
+{
+    shareBySides = bySides;
+    geometryDirty = TS_POLYGEN_ALL_SHAPES_DIRTY;
+    return;
+}
+
+inline void _polyGenEngine::setShapeSides(int shapeIx, int n)
+{
+    shapes[shapeIx].numVertices = static_cast<uint16_t>(n);
+    geometryDirty |= 1 << shapeIx; // Just this shape
+    return;
+}
+
+inline void _polyGenEngine::setShapeScale(int shapeIx, float scale)
+{
+    shapes[shapeIx].scale = scale;
+    geometryDirty |= 1 << shapeIx;
+    return;
+}
+
+inline void _polyGenEngine::setShapeOffset(int shapeIx, float x, float y)
+{
+    shapes[shapeIx].xOffset = polyGenClamp(x, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    shapes[shapeIx].yOffset = polyGenClamp(y, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    geometryDirty |= 1 << shapeIx;
+    return;
+}
+
+inline void _polyGenEngine::setShapeRotation(int shapeIx, float degrees)
+{
+    // Same direction as the main rotation
+    shapes[shapeIx].rotation_rad = -1.0f * degrees * TS_POLYGEN_PI / 180.0f;
+    geometryDirty |= 1 << shapeIx;
+    return;
+}
+
+inline void _polyGenEngine::setEventsEnabled(bool enabled)
+{
+    recordEvents = enabled;
+    return;
+}
+
+inline void _polyGenEngine::setTriggerWidth(float ms)
+{
+    triggerWidth_ms = ms;
+    triggerWidth = static_cast<int>(triggerWidth_ms * sampleRate / 1000.0f + 0.5f);
+    return;
+}
+
+inline void _polyGenEngine::setBlank(uint8_t mask, float ms, float level)
+{
+    blankMask = mask;
+    blankWidth_ms = ms;
+    blankWidth = static_cast<int>(blankWidth_ms * sampleRate / 1000.0f + 0.5f);
+    blankLevel = polyGenClamp(level, TS_POLYGEN_AMPL_MIN, TS_POLYGEN_AMPL_MAX);
+    return;
+}
+
+inline void _polyGenEngine::setQuality(uint8_t mode)
+{
+    qualityMode = mode;
+    return;
+}
+
+inline void _polyGenEngine::setCpuBudget(float fraction)
+{
+    cpuBudget = fraction;
+    return;
+}
+
+inline void _polyGenEngine::setMorph(bool on)
+{
+    morphOn = on;
+    return;
+}
+
+inline void _polyGenEngine::setMorphAmount(float amount)
+{
+    morphAmount = amount;
+    return;
+}
+
+inline void _polyGenEngine::setMorphCV(float volts)
+{
+    morphCV = volts;
+    return;
+}
+
+// The frequency range drops TS_POLYGEN_LFO_OCTAVES octaves now, the rendering switches at the next process()
+inline void _polyGenEngine::setLFO(bool on)
+{
+    lfoMode = on;
+    clockScale = (lfoMode) ? invSampleRate / (1 << TS_POLYGEN_LFO_OCTAVES) : invSampleRate;
+    lfoClockIn = NAN;
+    return;
+}
+
+// Stored at the next process(), once the main shape's table is up to date
+inline void _polyGenEngine::requestSnapshot(int snapshotIx)
+{
+    __atomic_fetch_or(&pendingStore, static_cast<uint8_t>(1 << snapshotIx), __ATOMIC_RELEASE);
+    return;
+}
+
+// Any load of this snapshot that process() hasn't taken yet is dropped, so it can't take a half-filled one
+inline _polyGenSnapshot* _polyGenEngine::stageSnapshot(int snapshotIx)
+{
+    __atomic_fetch_and(&pendingLoad, static_cast<uint8_t>(~(1 << snapshotIx)), __ATOMIC_ACQUIRE);
+    return &(stagedSnapshots[snapshotIx]);
+}
+
+// A store of this snapshot asked for before the load is dropped (a preset's snapshots win over its Store Snapshot)
+inline void _polyGenEngine::loadSnapshot(int snapshotIx)
+{
+    _polyGenSnapshot* staged = &(stagedSnapshots[snapshotIx]);
+    if (!staged->stored || staged->numPoints <= 0 || staged->numPoints > TS_POLYGEN_POINTS_MAX)
+    {
+        staged->stored = false;
+        staged->numPoints = 0;
+    }
+    __atomic_fetch_and(&pendingStore, static_cast<uint8_t>(~(1 << snapshotIx)), __ATOMIC_RELAXED);
+    __atomic_fetch_or(&pendingLoad, static_cast<uint8_t>(1 << snapshotIx), __ATOMIC_RELEASE);
+    return;
+}
+
+inline const _polyGenSnapshot* _polyGenEngine::snapshot(int snapshotIx) const
+{
+    return (pendingLoad & (1 << snapshotIx)) ? &(stagedSnapshots[snapshotIx]) : &(snapshots[snapshotIx]);
+}
+
+inline bool _polyGenEngine::isStorePending(int snapshotIx) const
+{
+    return (pendingStore & (1 << snapshotIx)) != 0;
+}
+
+inline void _polyGenEngine::reset()
+{
+    resetState(this);
+    return;
+}
+
+inline void _polyGenEngine::updateGovernor(uint32_t cycles, int numFrames)
+{
+    ::updateGovernor(this, cycles, numFrames);
+    return;
+}
+
+inline uint8_t _polyGenEngine::getAutoTier() const
+{
+    return autoTier;
+}
+
+// Replay: the tier the governor picked on the module (the host's timing can't reproduce it)
+inline void _polyGenEngine::setAutoTier(uint8_t t)
+{
+    autoTier = t;
+    return;
+}
+
+inline float _polyGenEngine::getSampleRate() const
+{
+    return sampleRate;
+}
+
+inline int _polyGenEngine::getNumShapes() const
+{
+    return numShapes;
+}
+
+inline const _polyGenShape* _polyGenEngine::getDrawnShape(int shapeIx) const
+{
+    return getShape(this, shapeIx);
+}
+
+inline float _polyGenEngine::getRotation() const
+{
+    return rotation_rad;
+}
+
+inline _polyGenVec _polyGenEngine::getRotationCenter() const
+{
+    return _polyGenVec(xCRot, yCRot);
+}
+
+inline _polyGenVec _polyGenEngine::getOffset() const
+{
+    return _polyGenVec(xOffset, yOffset);
+}
+
+#endif // POLYGEN_ENGINE_H
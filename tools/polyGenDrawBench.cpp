@@ -0,0 +1,154 @@
+// Host benchmark of the polyGen preview (draw()) with each Preview mode.
+//
+// Smooth mode calls NT_drawShapeF, which is firmware we don't have on the host, so it is stubbed here with an
+// antialiased float line (Xiaolin Wu's) of about the same work. Fast and Persistence run the plugin's own
+// rasterizer as-is. Prints the mean time per draw() and the # lit pixels for a few shapes, from a plain
+// triangle up to 4 curved 36-point stars and 360 sides.
+//
+// Build (with the disting NT API include directory on the include path):
+//     g++ -std=c++11 -O2 -I<distingNT_API>/include -o polyGenDrawBench tools/polyGenDrawBench.cpp
+// Run:
+//     polyGenDrawBench [# frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include "../polyGen.cpp"
+
+#define BENCH_NUM_BUSSES                    28
+#define BENCH_FRAMES_DEF                    2000
+
+// What the plugin needs from the NT firmware
+const _NT_globals NT_globals = { .sampleRate = 48000 };
+uint8_t NT_screen[128 * 64];
+void NT_drawText( int x, int y, const char* str, int colour, _NT_textAlignment align, _NT_textSize size ) {}
+void NT_drawShapeI( _NT_shape shape, int x0, int y0, int x1, int y1, int colour ) {}
+// Presets (the morph snapshots) aren't saved or loaded here
+void _NT_jsonStream::openArray() {}
+void _NT_jsonStream::closeArray() {}
+void _NT_jsonStream::openObject() {}
+void _NT_jsonStream::closeObject() {}
+void _NT_jsonStream::addMemberName( const char* name ) {}
+void _NT_jsonStream::addNumber( int value ) {}
+void _NT_jsonStream::addNumber( float value ) {}
+void _NT_jsonStream::addBoolean( bool value ) {}
+bool _NT_jsonParse::numberOfObjectMembers( int& num ) { return false; }
+bool _NT_jsonParse::numberOfArrayElements( int& num ) { return false; }
+bool _NT_jsonParse::matchName( const char* name ) { return false; }
+bool _NT_jsonParse::skipMember() { return false; }
+bool _NT_jsonParse::number( float& value ) { return false; }
+bool _NT_jsonParse::boolean( bool& value ) { return false; }
+
+// Stand-in for the firmware's antialiased line (Wu's algorithm, float end points, brighter pixel wins)
+static void stubPixel(int x, int y, float colour)
+{
+    if (x < 0 || x >= TS_POLYGEN_SCREEN_WIDTH || y < 0 || y >= TS_POLYGEN_SCREEN_HEIGHT)
+        return;
+    int c = static_cast<int>(colour + 0.5f);
+    if (c > 0)
+        rasterPixel(NT_screen, x, y, static_cast<uint8_t>((c > 15) ? 15 : c));
+}
+void NT_drawShapeF( _NT_shape shape, float x0, float y0, float x1, float y1, float colour )
+{
+    if (colour > 15.0f)
+        colour = 15.0f;
+    bool steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+    if (steep)
+    {
+        float t = x0; x0 = y0; y0 = t;
+        t = x1; x1 = y1; y1 = t;
+    }
+    if (x0 > x1)
+    {
+        float t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    float dx = x1 - x0;
+    float gradient = (dx == 0.0f) ? 1.0f : (y1 - y0) / dx;
+    float y = y0 + gradient * (roundf(x0) - x0);
+    for (int x = static_cast<int>(roundf(x0)); x <= static_cast<int>(roundf(x1)); x++)
+    {
+        int iy = static_cast<int>(floorf(y));
+        float frac = y - iy;
+        if (steep)
+        {
+            stubPixel(iy, x, colour * (1.0f - frac));
+            stubPixel(iy + 1, x, colour * frac);
+        }
+        else
+        {
+            stubPixel(x, iy, colour * (1.0f - frac));
+            stubPixel(x, iy + 1, colour * frac);
+        }
+        y += gradient;
+    }
+}
+
+struct BenchConfig
+{
+    const char* name;
+    int numVertices;
+    int innerRadius;     // %
+    int curvature;       // %
+    int numShapes;
+};
+
+int main(int argc, char** argv)
+{
+    int numFrames = (argc > 1) ? atoi(argv[1]) : BENCH_FRAMES_DEF;
+    static const BenchConfig configs[] = {
+        { "triangle", 3, 100, 0, 1 },
+        { "36-star", 36, 50, 0, 1 },
+        { "36-star curved", 36, 50, 60, 1 },
+        { "4x 36-star curved", 36, 50, 60, 4 },
+        { "360-gon", 360, 100, 0, 1 },
+        { "360-star", 360, 50, 0, 1 },
+    };
+
+    _NT_algorithmRequirements req;
+    calculateRequirements(req, NULL);
+    std::vector<uint8_t> sram(req.sram);
+    std::vector<uint8_t> dram(req.dram);
+    std::vector<float> busFrames(BENCH_NUM_BUSSES * 32, 0.0f);
+    std::vector<int16_t> v(req.numParameters);
+
+    printf("shape,preview,ns_per_draw,lit_pixels\n");
+    for (const BenchConfig& config : configs)
+    {
+        for (int mode = PREVIEW_SMOOTH; mode <= PREVIEW_PERSISTENCE; mode++)
+        {
+            _NT_algorithmMemoryPtrs ptrs = { sram.data(), dram.data(), NULL, NULL };
+            _NT_algorithm* alg = construct(ptrs, req, NULL);
+            for (uint32_t p = 0; p < req.numParameters; p++)
+                v[p] = parameters[p].def;
+            v[NUM_VERTICES_PARAM] = config.numVertices;
+            v[INNER_VERTICES_RADIUS_PARAM] = config.innerRadius;
+            v[CURVATURE_PARAM] = config.curvature;
+            v[NUM_SHAPES_PARAM] = config.numShapes;
+            for (int s = 0; s < TS_POLYGEN_SHAPES_MAX - 1; s++)
+                v[SHAPE2_NUM_VERTICES_PARAM + s * SHAPE_NUM_PARAMS] = config.numVertices;
+            v[PREVIEW_PARAM] = mode;
+            alg->v = v.data();
+            for (uint32_t p = 0; p < req.numParameters; p++)
+                parameterChanged(alg, p);
+            step(alg, busFrames.data(), 32 / 4); // Builds the shape tables
+
+            double totalNs = 0.0;
+            for (int frame = 0; frame < numFrames; frame++)
+            {
+                memset(NT_screen, 0, sizeof(NT_screen)); // The firmware clears the screen before draw()
+                auto start = std::chrono::steady_clock::now();
+                draw(alg);
+                auto end = std::chrono::steady_clock::now();
+                totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+            }
+            int litPixels = 0;
+            for (int i = 0; i < static_cast<int>(sizeof(NT_screen)); i++)
+                litPixels += ((NT_screen[i] & 0xF0) != 0) + ((NT_screen[i] & 0x0F) != 0);
+            printf("%s,%s,%.0f,%d\n", config.name, enumStringsPreview[mode], totalNs / numFrames, litPixels);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Host benchmark of the polyGen DSP engine (polyGenEngine.h) on its own, with no disting NT API or plugin glue.
+//
+// Runs _polyGenEngine::process() on a few shapes, from a plain triangle up to 4 curved 36-point stars and
+// 360 sides, in each quality tier and in LFO mode, and prints the mean time per sample. This is the same
+// engine step() runs on the module, so it is also a template for driving polyGen from any other host.
+//
+// Build (nothing else needed on the include path):
+//     g++ -std=c++11 -O2 -o polyGenEngineBench tools/polyGenEngineBench.cpp
+// Run:
+//     polyGenEngineBench [# blocks] [sample rate]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include "../polyGenEngine.h"
+
+#define BENCH_BLOCK_SIZE                    24      // Frames per block (as the NT at 48 kHz)
+#define BENCH_BLOCKS_DEF                    20000
+#define BENCH_SAMPLE_RATE_DEF               48000
+
+struct BenchConfig
+{
+    const char* name;
+    int numVertices;
+    float innerRadius;
+    float curvature;
+    int numShapes;
+    bool antiAlias;
+};
+
+int main(int argc, char** argv)
+{
+    int numBlocks = (argc > 1) ? atoi(argv[1]) : BENCH_BLOCKS_DEF;
+    float sampleRate = (argc > 2) ? static_cast<float>(atof(argv[2])) : BENCH_SAMPLE_RATE_DEF;
+    static const BenchConfig configs[] = {
+        { "triangle", 3, 1.0f, 0.0f, 1, false },
+        { "36-star", 36, 0.5f, 0.0f, 1, false },
+        { "36-star curved", 36, 0.5f, 0.6f, 1, false },
+        { "36-star curved AA", 36, 0.5f, 0.6f, 1, true },
+        { "4x 36-star curved", 36, 0.5f, 0.6f, 4, false },
+        { "360-gon", 360, 1.0f, 0.0f, 1, false },
+    };
+    // (One past Cached is LFO mode)
+    static const char* const qualityNames[] = { "Auto", "Full", "Control Rate", "Cached", "LFO" };
+
+    std::vector<uint8_t> memory(_polyGenEngine::memorySize());
+    std::vector<float> voct(BENCH_BLOCK_SIZE, 0.0f);
+    std::vector<float> x(BENCH_BLOCK_SIZE), y(BENCH_BLOCK_SIZE);
+
+    printf("shape,quality,ns_per_sample\n");
+    for (const BenchConfig& config : configs)
+    {
+        for (int quality = QUALITY_FULL; quality <= QUALITY_CACHED + 1; quality++)
+        {
+            _polyGenEngine* engine = new _polyGenEngine();
+            engine->setMemory(memory.data());
+            engine->prepare(sampleRate);
+            engine->setFrequency(1.0f);
+            engine->setNumVertices(config.numVertices);
+            engine->setInnerRadius(config.innerRadius);
+            engine->setCurvature(config.curvature);
+            engine->setAntiAlias(config.antiAlias);
+            engine->setNumShapes(config.numShapes);
+            for (int s = 1; s < TS_POLYGEN_SHAPES_MAX; s++)
+                engine->setShapeSides(s, config.numVertices);
+            engine->setSpin(true);
+            engine->setRotation(90.0f);
+            if (quality > QUALITY_CACHED)
+                engine->setLFO(true);
+            else
+                engine->setQuality(static_cast<uint8_t>(quality));
+            // Let the tables (and the cached cycle) build before timing
+            for (int b = 0; b < 2 * TS_POLYGEN_CACHE_SIZE / TS_POLYGEN_CACHE_BUILD_CHUNK; b++)
+                engine->process(voct.data(), x.data(), y.data(), BENCH_BLOCK_SIZE);
+
+            auto start = std::chrono::steady_clock::now();
+            for (int b = 0; b < numBlocks; b++)
+                engine->process(voct.data(), x.data(), y.data(), BENCH_BLOCK_SIZE);
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            printf("%s,%s,%.1f\n", config.name, qualityNames[quality], ns / (static_cast<double>(numBlocks) * BENCH_BLOCK_SIZE));
+            delete engine;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,371 @@
+// Host replay of a polyGen debug trace (see the "Trace buffer (KB)" specification and the Trace Capture parameter).
+//
+// Loads the recorded morph snapshots, then feeds the recorded parameter changes and input blocks back through the plugin's own parameterChanged() and step(),
+// in the same order, and prints one CSV line per block with the host time and the output hash next to the
+// cycles and hash recorded on the module. Replays are bit-exact run to run, so a trace from the field is a
+// repeatable benchmark case. The hashes only match the module's if the host float math does (same libm & flags).
+//
+// Build (with the disting NT API include directory on the include path):
+//     g++ -std=c++11 -O2 -I<distingNT_API>/include -o polyGenReplay tools/polyGenReplay.cpp
+// Run, on a raw trace buffer or on a preset saved after the capture (the trace is its "trace" member):
+//     polyGenReplay trace.bin > blocks.csv
+//     polyGenReplay preset.json > blocks.csv
+// Or check capture & replay against each other on the host (captures a few cases in this process, replays each
+// on a new instance and exits with 1 if any block's hash differs):
+//     polyGenReplay --self-test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "../polyGen.cpp"
+
+#ifndef POLYGEN_REPLAY_SAMPLE_RATE
+    #define POLYGEN_REPLAY_SAMPLE_RATE      48000   // Must match the trace (NT_globals is const)
+#endif
+#define REPLAY_NUM_BUSSES                   64      // Plenty for any routing
+#define REPLAY_BLOCK_SIZE                   24      // Frames per block for the self-test
+#define REPLAY_SELF_TEST_TRACE_KB          256
+#define REPLAY_SELF_TEST_WARMUP             40      // Blocks before the capture starts (so the state has moved on)
+#define REPLAY_SELF_TEST_BLOCKS             50      // Blocks captured
+
+// What the plugin needs from the NT firmware
+const _NT_globals NT_globals = { .sampleRate = POLYGEN_REPLAY_SAMPLE_RATE };
+uint8_t NT_screen[128 * 64];
+void NT_drawText( int x, int y, const char* str, int colour, _NT_textAlignment align, _NT_textSize size ) {}
+void NT_drawShapeI( _NT_shape shape, int x0, int y0, int x1, int y1, int colour ) {}
+void NT_drawShapeF( _NT_shape shape, float x0, float y0, float x1, float y1, float colour ) {}
+// Presets (the morph snapshots) aren't saved or loaded here
+void _NT_jsonStream::openArray() {}
+void _NT_jsonStream::closeArray() {}
+void _NT_jsonStream::openObject() {}
+void _NT_jsonStream::closeObject() {}
+void _NT_jsonStream::addMemberName( const char* name ) {}
+void _NT_jsonStream::addNumber( int value ) {}
+void _NT_jsonStream::addNumber( float value ) {}
+void _NT_jsonStream::addBoolean( bool value ) {}
+bool _NT_jsonParse::numberOfObjectMembers( int& num ) { return false; }
+bool _NT_jsonParse::numberOfArrayElements( int& num ) { return false; }
+bool _NT_jsonParse::matchName( const char* name ) { return false; }
+bool _NT_jsonParse::skipMember() { return false; }
+bool _NT_jsonParse::number( float& value ) { return false; }
+bool _NT_jsonParse::boolean( bool& value ) { return false; }
+
+// Trace saved in a preset: "trace": [ 32-bit words ], back to the raw bytes. False if there isn't one.
+static bool presetTrace(const std::vector<uint8_t>& file, std::vector<uint8_t>& trace)
+{
+    std::string text(file.begin(), file.end());
+    size_t pos = text.find("\"trace\"");
+    if (pos == std::string::npos)
+        return false;
+    pos = text.find('[', pos);
+    if (pos == std::string::npos)
+        return false;
+    trace.clear();
+    const char* p = text.c_str() + pos + 1;
+    while (true)
+    {
+        char* end;
+        long value = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        int32_t word = static_cast<int32_t>(value);
+        uint8_t bytes[sizeof(word)];
+        memcpy(bytes, &word, sizeof(word));
+        trace.insert(trace.end(), bytes, bytes + sizeof(word));
+        p = end;
+        while (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            p++;
+    }
+    return true;
+}
+
+// Results of a replay
+struct ReplayResult
+{
+    int numBlocks = 0;
+    int numMatches = 0;
+    double totalNs = 0.0;
+    double maxNs = 0.0;
+};
+
+// A new instance, as the module would construct it (traceKB of trace buffer), with every parameter at its default.
+struct ReplayInstance
+{
+    std::vector<uint8_t> sram, dram;
+    std::vector<int16_t> v;
+    _NT_algorithm* alg = NULL;
+
+    ReplayInstance(int32_t traceKB)
+    {
+        int32_t specs[ARRAY_SIZE(specifications)] = { 0 };
+        specs[kSpecTraceKB] = traceKB;
+        _NT_algorithmRequirements req;
+        calculateRequirements(req, specs);
+        sram.resize(req.sram);
+        dram.resize(req.dram);
+        _NT_algorithmMemoryPtrs ptrs = { sram.data(), dram.data(), NULL, NULL };
+        alg = construct(ptrs, req, specs);
+        v.resize(req.numParameters);
+        for (uint32_t p = 0; p < req.numParameters; p++)
+            v[p] = parameters[p].def;
+        alg->v = v.data();
+    }
+    _polyGenAlgorithm* algorithm() { return reinterpret_cast<_polyGenAlgorithm*>(alg); }
+};
+
+// Replay a trace on a new instance. False (and says why) if it isn't a trace this build can replay.
+static bool replay(const std::vector<uint8_t>& trace, bool print, ReplayResult& result)
+{
+    _polyGenTraceHeader header;
+    if (trace.size() < sizeof(header))
+    {
+        fprintf(stderr, "Not a polyGen trace\n");
+        return false;
+    }
+    memcpy(&header, trace.data(), sizeof(header));
+    if (header.magic != TS_POLYGEN_TRACE_MAGIC || header.version != TS_POLYGEN_TRACE_VERSION)
+    {
+        fprintf(stderr, "Not a polyGen trace (or a different version)\n");
+        return false;
+    }
+    if (header.numParameters != ARRAY_SIZE(parameters))
+    {
+        fprintf(stderr, "Trace has %d parameters, this build has %d\n", header.numParameters, static_cast<int>(ARRAY_SIZE(parameters)));
+        return false;
+    }
+    if (header.sampleRate != POLYGEN_REPLAY_SAMPLE_RATE)
+        fprintf(stderr, "Warning: trace is at %u Hz, replay is at %d Hz (build with -DPOLYGEN_REPLAY_SAMPLE_RATE=%u)\n", header.sampleRate, POLYGEN_REPLAY_SAMPLE_RATE, header.sampleRate);
+    if (header.flags & TS_POLYGEN_TRACE_FLAG_FULL)
+        fprintf(stderr, "Note: trace buffer filled up on the module, trace is truncated\n");
+    if (header.flags & TS_POLYGEN_TRACE_FLAG_CUT)
+        fprintf(stderr, "Note: only the first %d KB of the trace were saved with the preset\n", TS_POLYGEN_TRACE_EXPORT_KB);
+    uint32_t length = (header.length < trace.size()) ? header.length : static_cast<uint32_t>(trace.size());
+
+    //=== * Algorithm (no trace buffer of its own, just the cache) * ===
+    ReplayInstance instance(0);
+    _NT_algorithm* alg = instance.alg;
+    std::vector<int16_t>& v = instance.v;
+    _polyGenEngine* engine = &(instance.algorithm()->engine);
+
+    //=== * Replay * ===
+    std::vector<float> busFrames;
+    uint32_t pos = sizeof(header);
+    result = ReplayResult();
+    if (print)
+        printf("block,frames,host_ns,module_cycles,module_hash,host_hash\n");
+    while (pos < length)
+    {
+        uint8_t type = trace[pos];
+        if (type == TRACE_PARAMETER && pos + 4 <= length)
+        {
+            int16_t value;
+            memcpy(&value, &trace[pos + 2], sizeof(value));
+            v[trace[pos + 1]] = value;
+            parameterChanged(alg, trace[pos + 1]);
+            pos += 4;
+        }
+        else if (type == TRACE_BLOCK && pos + 16 <= length)
+        {
+            uint8_t numChannels = trace[pos + 1];
+            uint16_t numFrames;
+            uint32_t cycles, hash;
+            memcpy(&numFrames, &trace[pos + 2], sizeof(numFrames));
+            memcpy(&cycles, &trace[pos + 4], sizeof(cycles));
+            memcpy(&hash, &trace[pos + 8], sizeof(hash));
+            uint32_t dataBytes = numChannels * numFrames * sizeof(float);
+            if (pos + 16 + dataBytes > length)
+                break;
+            busFrames.assign(REPLAY_NUM_BUSSES * numFrames, 0.0f);
+            for (int ch = 0; ch < numChannels && ch < static_cast<int>(ARRAY_SIZE(traceInputParams)); ch++)
+            {
+                int bus = v[traceInputParams[ch]];
+                if (bus > 0)
+                    memcpy(&busFrames[(bus - 1) * numFrames], &trace[pos + 16 + ch * numFrames * sizeof(float)], numFrames * sizeof(float));
+            }
+            // Auto quality tier came from the module's CPU load, use the same one
+            engine->setAutoTier(trace[pos + 12]);
+            pos += 16 + dataBytes;
+
+            auto start = std::chrono::steady_clock::now();
+            step(alg, busFrames.data(), numFrames / 4);
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+            uint32_t hostHash = traceHash(&busFrames[(v[kParamOutput] - 1) * numFrames], &busFrames[(v[kParamOutput2] - 1) * numFrames], numFrames);
+            if (print)
+                printf("%d,%d,%.0f,%u,%08x,%08x\n", result.numBlocks, numFrames, ns, cycles, hash, hostHash);
+            result.numBlocks++;
+            result.numMatches += (hostHash == hash) ? 1 : 0;
+            result.totalNs += ns;
+            if (ns > result.maxNs)
+                result.maxNs = ns;
+        }
+        else if (type == TRACE_SNAPSHOT && pos + 8 <= length)
+        {
+            // Morph snapshots as they were on the module (loaded before the blocks that use them)
+            uint8_t snapshotIx = trace[pos + 1];
+            uint8_t flags = trace[pos + 2];
+            uint16_t numPoints;
+            memcpy(&numPoints, &trace[pos + 4], sizeof(numPoints));
+            uint32_t tableBytes = numPoints * sizeof(_polyGenVec);
+            if (snapshotIx >= TS_POLYGEN_SNAPSHOTS || numPoints > TS_POLYGEN_POINTS_MAX || pos + 8 + 3 * tableBytes > length)
+            {
+                fprintf(stderr, "Bad snapshot record at byte %u\n", pos);
+                return false;
+            }
+            _polyGenSnapshot* snapshot = engine->stageSnapshot(snapshotIx);
+            memcpy(snapshot->points, &trace[pos + 8], tableBytes);
+            memcpy(snapshot->lin, &trace[pos + 8 + tableBytes], tableBytes);
+            memcpy(snapshot->quad, &trace[pos + 8 + 2 * tableBytes], tableBytes);
+            snapshot->numPoints = numPoints;
+            snapshot->stored = (flags & TRACE_SNAPSHOT_STORED) != 0;
+            snapshot->useCurves = (flags & TRACE_SNAPSHOT_CURVES) != 0;
+            engine->loadSnapshot(snapshotIx);
+            if (flags & TRACE_SNAPSHOT_PENDING)
+                engine->requestSnapshot(snapshotIx);
+            pos += 8 + 3 * tableBytes;
+        }
+        else
+        {
+            fprintf(stderr, "Bad record at byte %u\n", pos);
+            return false;
+        }
+    }
+    return true;
+}
+
+//=== * Self-test * ===
+// Parameter settings for a self-test case (the rest at their defaults)
+struct SelfTestSetting
+{
+    uint8_t p;
+    int16_t value;
+};
+
+struct SelfTestCase
+{
+    const char* name;
+    SelfTestSetting settings[6];
+    int numSettings;
+    bool morph;             // Store snapshots A (triangle) & B (the settings' shape) before the capture
+};
+
+static void selfTestSet(ReplayInstance& instance, int p, int16_t value)
+{
+    instance.v[p] = value;
+    parameterChanged(instance.alg, p);
+    return;
+}
+
+// Run the plugin like the module would for a case: warm up (so the state has moved on), capture, then return the trace.
+static std::vector<uint8_t> selfTestCapture(const SelfTestCase& test)
+{
+    ReplayInstance instance(REPLAY_SELF_TEST_TRACE_KB);
+    for (uint32_t p = 0; p < instance.v.size(); p++)
+        parameterChanged(instance.alg, p);
+    std::vector<float> busFrames(REPLAY_NUM_BUSSES * REPLAY_BLOCK_SIZE, 0.0f);
+    int block = 0;
+    auto run = [&](int numBlocks)
+    {
+        for (int b = 0; b < numBlocks; b++, block++)
+        {
+            // Something moving on the frequency input
+            for (int i = 0; i < REPLAY_BLOCK_SIZE; i++)
+                busFrames[(instance.v[kParamInput] - 1) * REPLAY_BLOCK_SIZE + i] = 0.5f * sinf((block * REPLAY_BLOCK_SIZE + i) * 0.002f);
+            step(instance.alg, busFrames.data(), REPLAY_BLOCK_SIZE / 4);
+        }
+    };
+    if (test.morph)
+    {
+        selfTestSet(instance, NUM_VERTICES_PARAM, 3);
+        selfTestSet(instance, MORPH_STORE_PARAM, 1);
+        run(1);
+        selfTestSet(instance, MORPH_STORE_PARAM, 0);
+    }
+    for (int i = 0; i < test.numSettings; i++)
+        selfTestSet(instance, test.settings[i].p, test.settings[i].value);
+    if (test.morph)
+    {
+        selfTestSet(instance, MORPH_STORE_PARAM, 2);
+        run(1);
+        selfTestSet(instance, MORPH_STORE_PARAM, 0);
+        selfTestSet(instance, MORPH_PARAM, 1);
+        selfTestSet(instance, MORPH_AMOUNT_PARAM, 300);
+    }
+    run(REPLAY_SELF_TEST_WARMUP);
+    selfTestSet(instance, TRACE_CAPTURE_PARAM, 1);
+    run(REPLAY_SELF_TEST_BLOCKS);
+    selfTestSet(instance, TRACE_CAPTURE_PARAM, 0);
+    const uint8_t* buffer = instance.algorithm()->traceBuffer;
+    _polyGenTraceHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    return std::vector<uint8_t>(buffer, buffer + header.length);
+}
+
+static int selfTest()
+{
+    static const SelfTestCase cases[] = {
+        { "default", {}, 0, false },
+        { "rotation 90", { { ROTATION_PARAM, 90 } }, 1, false },
+        { "spin 90", { { ROTATION_PARAM, 90 }, { ROTATION_ABS_PARAM, 1 } }, 2, false },
+        { "spin 90, control rate", { { ROTATION_PARAM, 90 }, { ROTATION_ABS_PARAM, 1 }, { QUALITY_PARAM, QUALITY_CONTROL_RATE } }, 3, false },
+        { "cached", { { NUM_VERTICES_PARAM, 7 }, { QUALITY_PARAM, QUALITY_CACHED } }, 2, false },
+        { "3 shapes, curves, anti-alias", { { NUM_SHAPES_PARAM, 3 }, { CURVATURE_PARAM, 60 }, { ANTI_ALIAS_PARAM, 1 }, { INNER_VERTICES_RADIUS_PARAM, 50 } }, 4, false },
+        { "through-zero FM", { { FM_MODE_PARAM, FM_THROUGH_ZERO }, { FM_DEPTH_PARAM, 400 }, { ANTI_ALIAS_PARAM, 1 } }, 3, false },
+        { "LFO, spin", { { LFO_MODE_PARAM, 1 }, { ROTATION_PARAM, 90 }, { ROTATION_ABS_PARAM, 1 } }, 3, false },
+        { "morph", { { NUM_VERTICES_PARAM, 5 } }, 1, true },
+    };
+    int failed = 0;
+    for (const SelfTestCase& test : cases)
+    {
+        ReplayResult result;
+        bool ok = replay(selfTestCapture(test), false, result) && result.numBlocks == REPLAY_SELF_TEST_BLOCKS && result.numMatches == result.numBlocks;
+        printf("%s: %d of %d blocks match%s\n", test.name, result.numMatches, result.numBlocks, (ok) ? "" : " FAIL");
+        failed += (ok) ? 0 : 1;
+    }
+    return (failed > 0) ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s trace.bin|preset.json|--self-test\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "--self-test") == 0)
+        return selfTest();
+
+    //=== * Load the trace * ===
+    FILE* file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can't open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> trace;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        trace.insert(trace.end(), chunk, chunk + n);
+    fclose(file);
+    uint32_t magic = 0;
+    if (trace.size() >= sizeof(magic))
+        memcpy(&magic, trace.data(), sizeof(magic));
+    if (magic != TS_POLYGEN_TRACE_MAGIC)
+    {
+        std::vector<uint8_t> fromPreset;
+        if (presetTrace(trace, fromPreset))
+            trace.swap(fromPreset);
+    }
+
+    ReplayResult result;
+    if (!replay(trace, true, result))
+        return 1;
+    fprintf(stderr, "%d blocks, %d hashes match the module, host time total %.0f ns, mean %.0f ns, max %.0f ns\n",
+        result.numBlocks, result.numMatches, result.totalNs, (result.numBlocks > 0) ? result.totalNs / result.numBlocks : 0.0, result.maxNs);
+    return 0;
+}